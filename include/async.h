@@ -0,0 +1,95 @@
+#pragma once
+// ==============================================================================
+// async.h - Worker pool for asynchronous LINALG functions
+// ==============================================================================
+// MATRIX.*.ASYNC functions copy their arguments, queue the computation on a
+// bounded work-stealing pool owned by the add-in, and return immediately.
+// Workers deliver results with xlAsyncReturn. Identical requests that are
+// still in flight share one computation.
+// ==============================================================================
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "linalg.h"
+
+namespace xll {
+
+// ==============================================================================
+// Work-Stealing Pool
+// ==============================================================================
+
+// Each worker owns a deque. Workers pop their own newest task and steal the
+// oldest task of another worker when their deque is empty.
+class work_pool {
+public:
+    using task = std::function<void()>;
+
+    // Default threads is hardware concurrency less one for Excel's calc thread
+    explicit work_pool(unsigned threads = 0, size_t capacity = 1024);
+    work_pool(const work_pool&) = delete;
+    work_pool& operator=(const work_pool&) = delete;
+    ~work_pool();
+
+    // Queue t or return false if capacity tasks are already queued
+    bool submit(task t);
+    // Discard queued tasks and join the workers after their running tasks
+    void stop();
+
+    unsigned threads() const;
+    size_t pending() const;
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex; // guards sleeping and setting stopping
+    std::condition_variable ready;
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<size_t> next{ 0 };
+    size_t capacity;
+    std::atomic<bool> stopping{ false };
+
+    bool pop(size_t i, task& t);
+    void run(size_t i);
+};
+
+// Pool shared by all asynchronous LINALG functions, stopped in xlAutoClose
+work_pool& linalg_pool();
+
+// Call f(begin, end) on disjoint chunks covering [0, n) with at least grain
+// indices each. The calling thread takes chunks too and returns when all are
+// done, so it is safe to call from a worker. The first exception is rethrown.
+void parallel_for(Eigen::Index n, Eigen::Index grain, const std::function<void(Eigen::Index, Eigen::Index)>& f);
+
+// ==============================================================================
+// Asynchronous Calls
+// ==============================================================================
+
+// Deliver result to the asynchronous call handle with xlAsyncReturn
+void excel_async_return(const XLOPER12& handle, const XLOPER12& result);
+
+// Replaceable so the pool can be driven without Excel
+using async_return_fn = void (*)(const XLOPER12& handle, const XLOPER12& result);
+inline async_return_fn async_return = excel_async_return;
+
+// Evaluate f on the pool and return its result to handle. Calls with the same
+// key and inputs while f is in flight receive the same result. If the pool is
+// full f runs on the calling thread.
+void async_call(uint64_t key, std::vector<double> inputs, const XLOPER12& handle, std::function<OPER()> f);
+
+struct async_counters {
+    unsigned long long submitted, coalesced, inlined;
+};
+async_counters async_stats(bool reset = false);
+
+} // namespace xll
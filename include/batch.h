@@ -0,0 +1,32 @@
+#pragma once
+// ==============================================================================
+// batch.h - Batched kernels for many small matrices
+// ==============================================================================
+// A batch is k square n×n blocks stacked vertically in one FP12 argument, block m
+// in rows m·n to m·n + n - 1. Blocks up to batch_soa_max are repacked in chunks
+// as structure of arrays: entry (i,j) of every matrix in a chunk is contiguous,
+// so each elimination step is one SIMD loop across matrices. Chunks run on
+// linalg_pool().
+// ==============================================================================
+
+#include "linalg.h"
+
+namespace xll {
+
+// Largest block size processed in structure-of-arrays form
+inline constexpr Eigen::Index batch_soa_max = 8;
+
+// X_m = A_m^-1 B_m with partial pivoting for each block
+void batch_solve(const Eigen::Ref<const RowMatrixXd>& A, const Eigen::Ref<const RowMatrixXd>& B, Eigen::Ref<RowMatrixXd> X);
+
+// X_m = A_m^-1
+void batch_inverse(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<RowMatrixXd> X);
+
+// d(m) = det(A_m)
+void batch_determinant(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<Eigen::VectorXd> d);
+
+// L_m lower triangular with A_m = L_m L_m^T. Blocks that are not positive
+// definite are filled with NaN.
+void batch_cholesky(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<RowMatrixXd> L);
+
+} // namespace xll
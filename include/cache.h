@@ -0,0 +1,164 @@
+#pragma once
+// ==============================================================================
+// cache.h - Content-hash memoization of LINALG results
+// ==============================================================================
+// Results of expensive LINALG functions are keyed by a hash of the function id,
+// dimensions, and array bytes of their FP12 arguments. Each entry also keeps a
+// copy of its arguments that is compared on a hit, so a hash collision is a
+// miss rather than a wrong answer. Repeated calls on the same data cost one
+// hash and one comparison of the input plus one copy of the cached result.
+// ==============================================================================
+
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "linalg.h"
+
+namespace xll {
+
+// Function ids mixed into cache keys
+enum class cache_id : uint64_t {
+    det = 1,
+    rank,
+    inverse,
+    lu,
+    qr,
+    cholesky,
+    svd,
+    svd_full,
+    eigenvalues,
+    eigenvectors,
+    solve,
+    lstsq,
+    pinv,
+    solve_refine,
+    inverse32,
+    cholesky32,
+    svd32,
+    eigenvalues32,
+    solve32,
+    lstsq32,
+    logdet,
+};
+
+// Hash of (seed, rows, columns, array bytes) using SSE2 when available
+uint64_t fp_hash(uint64_t seed, const _FP12* fp);
+
+// Key for a single argument function
+inline uint64_t cache_key(cache_id id, const _FP12* pa)
+{
+    return fp_hash(static_cast<uint64_t>(id), pa);
+}
+// Key for a two argument function
+inline uint64_t cache_key(cache_id id, const _FP12* pa, const _FP12* pb)
+{
+    return fp_hash(fp_hash(static_cast<uint64_t>(id), pa), pb);
+}
+
+// Arguments with fewer elements than this are cheaper to recompute than to cache
+inline constexpr int cache_min_size = 16 * 16;
+
+inline bool cacheable(const _FP12* pa)
+{
+    return xll::size(*pa) >= cache_min_size;
+}
+// Both arguments are hashed, compared and stored, so they count together
+inline bool cacheable(const _FP12* pa, const _FP12* pb)
+{
+    return pa && pb && xll::size(*pa) > 0 && xll::size(*pb) > 0
+        && xll::size(*pa) + xll::size(*pb) >= cache_min_size;
+}
+
+// Bounded LRU cache of FP12 results with a byte budget
+class result_cache {
+    struct entry {
+        uint64_t key;
+        int rows;
+        int columns;
+        std::vector<double> array;
+        std::vector<double> inputs; // dimensions and elements of the arguments
+    };
+
+    mutable std::mutex mutex;
+    std::list<entry> lru; // most recently used first
+    std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+    size_t bytes = 0;
+    size_t limit;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+
+    void evict(size_t target);
+public:
+    explicit result_cache(size_t budget);
+    result_cache(const result_cache&) = delete;
+    result_cache& operator=(const result_cache&) = delete;
+
+    // Copy the result cached for key and the arguments pa and pb (nullptr for
+    // one argument) into the thread-local result buffer or return nullptr
+    _FP12* find(uint64_t key, const _FP12* pa, const _FP12* pb);
+    bool find(uint64_t key, const _FP12* pa, const _FP12* pb, double& value);
+
+    // Store a copy of result and of its arguments
+    void insert(uint64_t key, const _FP12* pa, const _FP12* pb, const _FP12* result);
+    void insert(uint64_t key, const _FP12* pa, const _FP12* pb, double value);
+
+    // Set byte budget, evicting as needed, and return the previous budget
+    size_t budget(size_t new_limit);
+    void clear();
+
+    struct counters {
+        unsigned long long hits, misses, entries, bytes, budget;
+    };
+    counters stats(bool reset = false);
+};
+
+// Cache shared by all LINALG functions
+result_cache& linalg_cache();
+
+// Return the cached result for key and the arguments pa and pb (nullptr for
+// one argument) or compute, store, and return f()
+template<class F>
+inline auto memoize(uint64_t key, const _FP12* pa, const _FP12* pb, F&& f)
+{
+    auto& cache = linalg_cache();
+
+    if constexpr (std::is_same_v<std::invoke_result_t<F>, double>) {
+        double value;
+        if (!cache.find(key, pa, pb, value)) {
+            value = f();
+            if (!std::isnan(value)) {
+                cache.insert(key, pa, pb, value);
+            }
+        }
+
+        return value;
+    }
+    else {
+        _FP12* result = cache.find(key, pa, pb);
+        if (!result) {
+            result = f();
+            cache.insert(key, pa, pb, result);
+        }
+
+        return result;
+    }
+}
+
+// Memoize f() on the contents of pa
+template<class F>
+inline auto cached(cache_id id, const _FP12* pa, F&& f)
+{
+    return cacheable(pa) ? memoize(cache_key(id, pa), pa, nullptr, f) : f();
+}
+// Memoize f() on the contents of pa and pb
+template<class F>
+inline auto cached(cache_id id, const _FP12* pa, const _FP12* pb, F&& f)
+{
+    return cacheable(pa, pb) ? memoize(cache_key(id, pa, pb), pa, pb, f) : f();
+}
+
+} // namespace xll
@@ -0,0 +1,120 @@
+#pragma once
+// ==============================================================================
+// dense.h - Dense matrix handles
+// ==============================================================================
+// A large LINALG result can be kept in a handle<dense_matrix> instead of being
+// copied into the grid. MATRIX.WINDOW and MATRIX.AT copy out only the cells a
+// formula references, so the FP12 marshalled back to Excel stays small no
+// matter how large the matrix is.
+//
+// A dense_matrix is a strided view of reference-counted storage. Slices and
+// transposes made with \MATRIX.VIEW and \MATRIX.TRANSPOSE share the storage
+// of their parent instead of copying it, and keep it alive after the parent
+// handle is deleted.
+//
+// Storage is copy-on-write. Reshapes, identity transforms and re-wrapping an
+// existing handle share one buffer, and only a handle that is modified while
+// others still refer to its storage takes a private copy.
+//
+// An appendable dense_matrix reserves spare rows and grows its storage
+// geometrically, or by a fixed number of rows, so adding a row is O(1)
+// amortized. Rows are appended past the end of what any view can see, so
+// views and copies stay valid without copying. In ring mode the last N rows
+// are kept in 2N rows of storage with every row written twice, so the latest
+// N rows are always contiguous and readable through the same strided map.
+// ==============================================================================
+
+#include <memory>
+#include <utility>
+#include "linalg.h"
+
+namespace xll {
+
+// Strided view of dense_matrix storage or of an FP12 argument. A view of a
+// handle holds a reference to its storage, so it stays valid after the handle
+// is deleted, as happens to a handle returned by a nested call when the
+// lookup of it goes out of scope.
+class dense_view : public Eigen::Map<const RowMatrixXd, Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> {
+    std::shared_ptr<const RowMatrixXd> storage_; // null for FP12 arguments
+public:
+    using map = Eigen::Map<const RowMatrixXd, Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+    dense_view(const double* data, Eigen::Index rows, Eigen::Index cols, const Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>& stride,
+        std::shared_ptr<const RowMatrixXd> storage = nullptr)
+        : map(data, rows, cols, stride), storage_(std::move(storage))
+    { }
+};
+using dense_view_mut = Eigen::Map<RowMatrixXd, Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+class dense_matrix {
+    std::shared_ptr<RowMatrixXd> storage_;
+    Eigen::Index offset_;
+    Eigen::Index rows_, cols_;
+    Eigen::Index row_stride_, col_stride_; // elements between adjacent rows and columns
+    // Appendable handles only. Copies and views are not appendable.
+    bool appendable_ = false;
+    Eigen::Index chunk_ = 0;    // rows added when full, or 0 to double the capacity
+    Eigen::Index last_ = 0;     // rows kept in ring mode, or 0 to keep all
+    Eigen::Index appended_ = 0; // rows appended so far
+public:
+    explicit dense_matrix(RowMatrixXd A);
+    // Empty appendable matrix with room for capacity rows. A nonzero last
+    // keeps only the latest last rows.
+    dense_matrix(Eigen::Index cols, Eigen::Index capacity, Eigen::Index chunk, Eigen::Index last);
+    // Shares storage but is not appendable
+    dense_matrix(const dense_matrix& A);
+    dense_matrix& operator=(const dense_matrix&) = delete;
+    // rows×cols view of parent from (row, col) taking every row_step-th row
+    // and col_step-th column
+    dense_matrix(const dense_matrix& parent, Eigen::Index row, Eigen::Index col, Eigen::Index rows, Eigen::Index cols,
+        Eigen::Index row_step = 1, Eigen::Index col_step = 1);
+
+    // Transposed view sharing the same storage
+    dense_matrix transpose() const;
+    // The elements in row-major order as rows×cols, sharing storage unless
+    // this is a strided view
+    dense_matrix reshape(Eigen::Index rows, Eigen::Index cols) const;
+
+    // Writable view of the elements. Copies them first if other handles share
+    // the storage. Not available for ring buffers.
+    dense_view_mut modify();
+
+    // Add rows to the bottom of an appendable matrix
+    void append(const Eigen::Ref<const RowMatrixXd>& X);
+    bool appendable() const
+    {
+        return appendable_;
+    }
+
+    // Number of handles sharing the storage, including this one
+    long owners() const
+    {
+        return storage_.use_count();
+    }
+    // Size of the storage this handle refers to
+    size_t bytes() const
+    {
+        return static_cast<size_t>(storage_->size()) * sizeof(double);
+    }
+
+    Eigen::Index rows() const
+    {
+        return rows_;
+    }
+    Eigen::Index cols() const
+    {
+        return cols_;
+    }
+    dense_view view() const
+    {
+        return dense_view(storage_->data() + offset_, rows_, cols_, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(row_stride_, col_stride_), storage_);
+    }
+
+    // Rows last appended by each calling cell
+    applied_inputs applied;
+};
+
+// View a 1×1 array holding a handle to a dense_matrix, or the array itself
+dense_view dense_map(const _FP12* pa);
+
+} // namespace xll
@@ -0,0 +1,257 @@
+#pragma once
+// ==============================================================================
+// factor.h - Matrix factorization handles
+// ==============================================================================
+// A factorization is computed once by an uncalced \MATRIX.* constructor and
+// reused by the MATRIX.FACTOR.* accessors, so each O(n³) decomposition can
+// serve many O(n²) solves and queries.
+// ==============================================================================
+
+#include <vector>
+#include "linalg.h"
+
+// Suppress warnings from Eigen library headers (external code)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#elif defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wnull-dereference"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#endif
+
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+#include <Eigen/LU>
+#include <Eigen/QR>
+#include <Eigen/SVD>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#elif defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+namespace xll {
+
+// ==============================================================================
+// Factorization Interface
+// ==============================================================================
+
+// Base class for all factorizations held by handle<factor>
+class factor {
+public:
+    virtual ~factor() = default;
+
+    // Dimensions of the factored matrix A
+    virtual Eigen::Index rows() const = 0;
+    virtual Eigen::Index cols() const = 0;
+
+    // Solve A x = b (least squares for non-square A)
+    virtual Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const = 0;
+    // Left factor: L, L, Q, U, or eigenvectors
+    virtual Eigen::MatrixXd U() const = 0;
+    // Right factor: U, L^T, R, or V (empty for eigendecompositions)
+    virtual Eigen::MatrixXd V() const = 0;
+    // Diagonal of the triangular factor, singular values, or eigenvalues
+    virtual Eigen::VectorXd values() const = 0;
+    // log|det(A)| for square A
+    virtual double logdet() const = 0;
+};
+
+// ==============================================================================
+// Factorizations
+// ==============================================================================
+
+// Factorizations are computed and stored in T, which is double or float.
+// Float halves the memory of a handle and doubles SIMD width. Results are
+// widened to double at the factor interface.
+
+// P A = L U with partial pivoting
+template<class T>
+class basic_lu_factor : public factor {
+    using matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+    Eigen::PartialPivLU<matrix> lu;
+public:
+    explicit basic_lu_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// A = L L^T for symmetric positive-definite A
+template<class T>
+class basic_chol_factor : public factor {
+    using matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+    Eigen::LLT<matrix> llt;
+public:
+    explicit basic_chol_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// A = Q R with Householder reflections
+template<class T>
+class basic_qr_factor : public factor {
+    using matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+    Eigen::HouseholderQR<matrix> qr;
+public:
+    explicit basic_qr_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// A = U Σ V^T (thin)
+template<class T>
+class basic_svd_factor : public factor {
+    using matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+    Eigen::BDCSVD<matrix, Eigen::ComputeThinU | Eigen::ComputeThinV> svd;
+public:
+    explicit basic_svd_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// A = X Λ X^-1 (real parts of eigenvalues and eigenvectors are reported)
+template<class T>
+class basic_eig_factor : public factor {
+    using matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+    Eigen::EigenSolver<matrix> es;
+    Eigen::PartialPivLU<Eigen::Matrix<std::complex<T>, Eigen::Dynamic, Eigen::Dynamic>> lu; // of the eigenvector matrix X
+public:
+    explicit basic_eig_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+using lu_factor = basic_lu_factor<double>;
+using chol_factor = basic_chol_factor<double>;
+using qr_factor = basic_qr_factor<double>;
+using svd_factor = basic_svd_factor<double>;
+using eig_factor = basic_eig_factor<double>;
+
+// ==============================================================================
+// Updatable Factorizations
+// ==============================================================================
+
+// Both keep an upper triangular R with A = R^T R (Cholesky) or A^T A = R^T R
+// (QR) and modify it with Givens rotations in O(n²) instead of refactoring.
+// A downdate is unstable when 1 - ||R^-T x||² is small, so those refactor
+// from the stored matrix instead.
+
+// R^T R + x^T x by Givens rotations in O(n²)
+void triangular_update(RowMatrixXd& R, Eigen::RowVectorXd x);
+
+// R^T R - x^T x in O(n²) as in LINPACK dchdd. Returns false and leaves R
+// unchanged if the downdate is unstable or the result would not be positive definite.
+bool triangular_downdate(RowMatrixXd& R, const Eigen::RowVectorXd& x);
+
+// Factorization that can be modified in place
+class updatable_factor : public factor {
+public:
+    // Add the row vector x: A + x^T x for Cholesky, append row x for QR
+    virtual void update(const Eigen::RowVectorXd& x) = 0;
+    // Remove the row vector x: A - x^T x for Cholesky, delete row x for QR
+    virtual void downdate(const Eigen::RowVectorXd& x) = 0;
+    // Append a column: for Cholesky c(n+1) borders A with c and its last entry
+    // is the new diagonal; for QR c(m) is the new last column of A
+    virtual void append(const Eigen::VectorXd& c) = 0;
+    // Delete column j (and row j for Cholesky)
+    virtual void remove(Eigen::Index j) = 0;
+
+    // Number of unstable downdates that refactored instead
+    Eigen::Index refactorizations() const
+    {
+        return refactored;
+    }
+
+    // Modifications last made by each calling cell
+    applied_inputs applied;
+protected:
+    Eigen::Index refactored = 0;
+};
+
+// A = R^T R for symmetric positive-definite A
+class chol_update_factor : public updatable_factor {
+    Eigen::MatrixXd A;
+    RowMatrixXd R;
+    void refactor(Eigen::MatrixXd A1);
+public:
+    explicit chol_update_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+
+    void update(const Eigen::RowVectorXd& x) override;
+    void downdate(const Eigen::RowVectorXd& x) override;
+    void append(const Eigen::VectorXd& c) override;
+    void remove(Eigen::Index j) override;
+};
+
+// A = Q R for A(m×n) with m ≥ n and full column rank. Only R is stored; Q = A R^-1.
+// Rows of A are kept in a buffer that grows at the end and shrinks from the
+// front, so a rolling window appends and deletes rows in amortized O(n).
+class qr_update_factor : public updatable_factor {
+    std::vector<double> a; // row-major rows of A starting at row first
+    Eigen::Index first = 0;
+    Eigen::Index m = 0;
+    Eigen::Index n = 0;
+    RowMatrixXd R;
+    Eigen::Map<const RowMatrixXd> A() const;
+    void refactor();
+public:
+    explicit qr_update_factor(const Eigen::Ref<const RowMatrixXd>& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+
+    void update(const Eigen::RowVectorXd& x) override;
+    void downdate(const Eigen::RowVectorXd& x) override;
+    void append(const Eigen::VectorXd& c) override;
+    void remove(Eigen::Index j) override;
+};
+
+} // namespace xll
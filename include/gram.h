@@ -0,0 +1,33 @@
+#pragma once
+// ==============================================================================
+// gram.h - Covariance, correlation and Gram matrices
+// ==============================================================================
+// X^T W X is accumulated over cache-sized row blocks of the row-major FP12
+// argument with symmetric rank-k updates of the lower triangle only, so the
+// transpose is never formed. Weights and demeaning are applied to each block
+// while it is in cache. Block means are merged with the pairwise update of
+// Chan, Golub and LeVeque, so demeaning takes a single pass over X.
+// ==============================================================================
+
+#include "linalg.h"
+
+namespace xll {
+
+// Weighted second moments of the rows of X
+struct gram_moments {
+    Eigen::MatrixXd scatter; // lower triangle of Σ w_i (x_i - mean)^T (x_i - mean)
+    Eigen::RowVectorXd mean; // weighted mean of the rows, zero if not demeaned
+    double weight = 0;       // Σ w_i
+    double weight2 = 0;      // Σ w_i²
+
+    explicit gram_moments(Eigen::Index n = 0)
+        : scatter(Eigen::MatrixXd::Zero(n, n)), mean(Eigen::RowVectorXd::Zero(n))
+    { }
+};
+
+// Moments of the rows of X with optional nonnegative weights w (one per row, or
+// nullptr for unit weights). Contiguous row ranges are accumulated on
+// linalg_pool() and merged in order, so the result does not depend on timing.
+gram_moments accumulate_gram(const Eigen::Ref<const RowMatrixXd>& X, const double* w, bool demean);
+
+} // namespace xll
@@ -0,0 +1,188 @@
+#pragma once
+// ==============================================================================
+// iterative.h - Preconditioned Krylov solvers
+// ==============================================================================
+// CG, BiCGSTAB and restarted GMRES only need products y = A x, so the same
+// code solves dense ranges, sparse handles, and matrix-free operators.
+// ==============================================================================
+
+#include <memory>
+#include <type_traits>
+#include "dense.h"
+#include "sparse.h"
+
+// Suppress warnings from Eigen library headers (external code)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#elif defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wnull-dereference"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#endif
+
+#include <Eigen/IterativeLinearSolvers>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#elif defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+namespace xll {
+
+// ==============================================================================
+// Linear Operators
+// ==============================================================================
+
+// Base class for all operators held by handle<linear_operator>
+class linear_operator {
+public:
+    virtual ~linear_operator() = default;
+
+    virtual Eigen::Index rows() const = 0;
+    virtual Eigen::Index cols() const = 0;
+
+    // y = A x
+    virtual void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const = 0;
+    // y = A^T x
+    virtual void apply_transpose(const Eigen::VectorXd& x, Eigen::VectorXd& y) const = 0;
+    // Diagonal of A for Jacobi preconditioning
+    virtual Eigen::VectorXd diagonal() const = 0;
+    // Entries of A for incomplete factorizations
+    virtual sparse_matrix to_sparse() const
+    {
+        ensure_message(false, "matrix-free operator has no entries");
+
+        return sparse_matrix();
+    }
+};
+
+// Operator for a dense or sparse matrix stored or viewed by M
+template<class M>
+class matrix_operator : public linear_operator {
+    M A;
+
+    static constexpr bool is_sparse = std::is_base_of_v<Eigen::SparseMatrixBase<std::decay_t<M>>, std::decay_t<M>>;
+public:
+    explicit matrix_operator(M A_)
+        : A(A_)
+    { }
+
+    Eigen::Index rows() const override
+    {
+        return A.rows();
+    }
+    Eigen::Index cols() const override
+    {
+        return A.cols();
+    }
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override
+    {
+        y.noalias() = A * x;
+    }
+    void apply_transpose(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override
+    {
+        y.noalias() = A.transpose() * x;
+    }
+    Eigen::VectorXd diagonal() const override
+    {
+        return A.diagonal();
+    }
+    sparse_matrix to_sparse() const override
+    {
+        if constexpr (is_sparse) {
+            return A;
+        }
+        else {
+            return sparse_from_dense(A);
+        }
+    }
+};
+
+// Views of FP12 arguments, dense handles and sparse handles. A dense_view
+// holds a reference to the storage of a dense handle, so the operator stays
+// valid after the handle lookup goes out of scope.
+using dense_view_operator = matrix_operator<dense_view>;
+using sparse_view_operator = matrix_operator<const sparse_matrix&>;
+
+// Matrix-free A^T A + λI for regularized normal equations
+class normal_operator : public linear_operator {
+    std::unique_ptr<linear_operator> A;
+    double lambda;
+    Eigen::VectorXd d; // diagonal
+public:
+    // Takes a copy of A
+    template<class M>
+    normal_operator(const M& A_, double lambda_)
+        : A(new matrix_operator<M>(A_)), lambda(lambda_)
+    {
+        d = (Eigen::RowVectorXd::Ones(A_.rows()) * A_.cwiseAbs2()).transpose();
+        d.array() += lambda;
+    }
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    void apply_transpose(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    Eigen::VectorXd diagonal() const override;
+};
+
+// Matrix-free diag(d) + U V^T
+class lowrank_operator : public linear_operator {
+    Eigen::VectorXd d;
+    Eigen::MatrixXd U, V;
+public:
+    lowrank_operator(Eigen::VectorXd d, Eigen::MatrixXd U, Eigen::MatrixXd V);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    void apply(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    void apply_transpose(const Eigen::VectorXd& x, Eigen::VectorXd& y) const override;
+    Eigen::VectorXd diagonal() const override;
+};
+
+// Operator for an FP12 argument holding a dense matrix or a 1×1 dense, sparse or operator handle.
+// The result is owned by view, which also keeps the handle lookup and must outlive the result.
+const linear_operator* fp_operator(const _FP12* pa, std::unique_ptr<linear_operator>& view);
+
+// ==============================================================================
+// Preconditioners
+// ==============================================================================
+
+enum class preconditioner_type { none, jacobi, ic, ilut };
+
+// z = M^-1 r
+class preconditioner {
+public:
+    virtual ~preconditioner() = default;
+
+    virtual void solve(const Eigen::VectorXd& r, Eigen::VectorXd& z) const = 0;
+};
+
+std::unique_ptr<preconditioner> make_preconditioner(const linear_operator& A, preconditioner_type type);
+
+// ==============================================================================
+// Solvers
+// ==============================================================================
+
+enum class iterative_method { cg, bicgstab, gmres };
+
+// GMRES Krylov subspace dimension between restarts
+inline constexpr int gmres_restart = 30;
+
+struct iterative_result {
+    int iterations;
+    double residual; // ||b - A x|| / ||b||
+};
+
+// Solve A x = b starting from x until the relative residual is below tol
+iterative_result iterative_solve(const linear_operator& A, const preconditioner& M,
+    const Eigen::VectorXd& b, Eigen::VectorXd& x,
+    iterative_method method, double tol, int maxiter);
+
+} // namespace xll
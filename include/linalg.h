@@ -6,6 +6,11 @@
 // Uses Eigen 5.0+ for high-performance linear algebra
 // ==============================================================================
 
+#include <atomic>
+#include <cmath>
+#include <initializer_list>
+#include <map>
+#include <vector>
 #include "xll24/include/xll.h"
 
 // Suppress warnings from Eigen library headers (external code)
@@ -36,16 +41,223 @@ namespace xll {
 // Helper Functions - Excel ↔ Eigen Conversions
 // ==============================================================================
 
-// Convert Excel FP12 array to Eigen MatrixXd
+// Excel FP12 arrays are row-major
+using RowMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Bytes moved between Excel buffers and the LINALG kernels (see MATRIX.TRAFFIC)
+struct fp_traffic {
+    std::atomic<unsigned long long> read{ 0 };    // viewed in place from FP12 arguments
+    std::atomic<unsigned long long> written{ 0 }; // evaluated into FP12 results
+    std::atomic<unsigned long long> copied{ 0 };  // staged through intermediate matrices
+
+    void reset() noexcept
+    {
+        read = 0;
+        written = 0;
+        copied = 0;
+    }
+};
+fp_traffic& linalg_traffic();
+
+// View Excel FP12 array in place (no copy)
+Eigen::Map<const RowMatrixXd> fp_map(const _FP12* fp);
+
+// View Excel FP12 array in place as the column-major transpose (no copy)
+Eigen::Map<const Eigen::MatrixXd> fp_map_transpose(const _FP12* fp);
+
+// Convert Excel FP12 array to Eigen MatrixXd (copies into column-major storage)
 Eigen::MatrixXd fp_to_eigen(const _FP12* fp);
 
-// Convert Eigen MatrixXd to Excel FP12 array (static storage)
-_FP12* eigen_to_fp(const Eigen::MatrixXd& mat);
+// Narrow Excel FP12 array to single precision (copies into column-major storage)
+Eigen::MatrixXf fp_to_float(const _FP12* fp);
+
+// Result buffers are thread_local so every LINALG function can be registered
+// as thread safe. The returned pointer is valid until the next call on the
+// same thread, which is all Excel requires of an FP12 return value.
+
+// Resize the thread-local result buffer to rows x cols
+_FP12* fp_alloc(Eigen::Index rows, Eigen::Index cols);
+
+// Writable view of a result buffer returned by fp_alloc
+inline Eigen::Map<RowMatrixXd> fp_out(_FP12* fp)
+{
+    return Eigen::Map<RowMatrixXd>(fp->array, fp->rows, fp->columns);
+}
+
+// Index of the case-insensitive string o in names, the number o itself,
+// or init if o is missing. Returns -1 for an unknown name.
+int option(const OPER& o, std::initializer_list<const char*> names, int init);
+
+// Nonnegative integer argument less than 2³¹. Rejects NaN and fractions
+// rather than truncating them.
+Eigen::Index to_index(double n);
+// 1-based optional index argument as a 0-based index, or 0 if missing
+Eigen::Index first_index(double i);
+
+// Evaluate Eigen expression directly into the thread-local result buffer
+template<class Derived>
+inline _FP12* eigen_to_fp(const Eigen::MatrixBase<Derived>& mat)
+{
+    _FP12* result = fp_alloc(mat.rows(), mat.cols());
+    fp_out(result) = mat;
+
+    return result;
+}
+template<class Derived>
+inline _FP12* eigen_to_fp(const Eigen::TriangularBase<Derived>& mat)
+{
+    _FP12* result = fp_alloc(mat.rows(), mat.cols());
+    fp_out(result) = mat;
+
+    return result;
+}
+
+// Evaluate Eigen vector expression as column vector (thread-local storage)
+template<class Derived>
+inline _FP12* vector_to_fp(const Eigen::MatrixBase<Derived>& vec)
+{
+    _FP12* result = fp_alloc(vec.size(), 1);
+    Eigen::Map<Eigen::VectorXd>(result->array, vec.size()) = vec;
+
+    return result;
+}
+
+// Evaluate Eigen vector expression as row vector (thread-local storage)
+template<class Derived>
+inline _FP12* row_vector_to_fp(const Eigen::MatrixBase<Derived>& vec)
+{
+    _FP12* result = fp_alloc(1, vec.size());
+    Eigen::Map<Eigen::VectorXd>(result->array, vec.size()) = vec;
+
+    return result;
+}
+
+// ==============================================================================
+// Structure Detection
+// ==============================================================================
+
+// Zero pattern and symmetry of a square matrix
+struct matrix_structure {
+    Eigen::Index size;  // n
+    Eigen::Index lower; // lower bandwidth: A(i,j) = 0 for i - j > lower
+    Eigen::Index upper; // upper bandwidth: A(i,j) = 0 for j - i > upper
+    bool symmetric;     // A = A^T exactly
+
+    bool diagonal() const
+    {
+        return lower == 0 && upper == 0;
+    }
+    bool lower_triangular() const
+    {
+        return upper == 0;
+    }
+    bool upper_triangular() const
+    {
+        return lower == 0;
+    }
+    // Narrow enough that O(n·lower·(lower + upper)) band LU beats O(n³) dense LU
+    bool banded() const;
+};
+
+// Scan the entries of square A once, starting from the corners so that
+// general matrices are rejected after a few reads
+matrix_structure probe_structure(const Eigen::Ref<const RowMatrixXd>& A);
+
+// Kernels chosen by the structured LINALG functions (see MATRIX.SOLVER.PATHS)
+enum class solver_path { general, diagonal, triangular, cholesky, banded, selfadjoint, fixed, count };
+
+struct solver_paths {
+    std::atomic<unsigned long long> taken[static_cast<int>(solver_path::count)] = {};
+
+    void take(solver_path p) noexcept
+    {
+        taken[static_cast<int>(p)].fetch_add(1, std::memory_order_relaxed);
+    }
+    void reset() noexcept
+    {
+        for (auto& t : taken) {
+            t = 0;
+        }
+    }
+};
+solver_paths& linalg_paths();
+
+// LU with partial pivoting of a band matrix (LAPACK dgbtrf layout)
+class band_lu {
+    Eigen::Index n, kl, ku;
+    Eigen::MatrixXd ab; // A(i,j) at ab(kl + ku + i - j, j) with kl extra rows for fill-in
+    std::vector<Eigen::Index> ipiv;
+    int sign = 1;
+    bool singular = false;
+
+    double& at(Eigen::Index i, Eigen::Index j)
+    {
+        return ab(kl + ku + i - j, j);
+    }
+    double at(Eigen::Index i, Eigen::Index j) const
+    {
+        return ab(kl + ku + i - j, j);
+    }
+public:
+    // A has lower bandwidth kl and upper bandwidth ku
+    band_lu(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Index kl, Eigen::Index ku);
+
+    bool invertible() const
+    {
+        return !singular;
+    }
+    double determinant() const;
+    // Overwrite B with A^-1 B
+    void solve(Eigen::MatrixXd& B) const;
+};
+
+// ==============================================================================
+// Kernel Selection
+// ==============================================================================
+
+// Sizes at which the faster of two candidate kernels changes. Defaults are
+// replaced at load by measured values (see tune.h).
+struct kernel_thresholds {
+    // min(m,n) from which BDCSVD beats JacobiSVD
+    std::atomic<Eigen::Index> svd_divide_conquer{ 32 };
+    // m·n·k from which GEMM is split across linalg_pool()
+    std::atomic<Eigen::Index> gemm_parallel{ Eigen::Index(1) << 21 };
+    // n / (2·kl + ku + 1) from which band LU beats dense LU
+    std::atomic<Eigen::Index> band_ratio{ 8 };
+};
+kernel_thresholds& linalg_thresholds();
+
+// ==============================================================================
+// Handles
+// ==============================================================================
+
+// True if x, a number passed where a handle may be, can be a handle. Only
+// these are converted to pointers and looked up.
+inline bool is_handle(double x)
+{
+    return x > 0 && x < 0x1p53 && x == std::floor(x);
+}
 
-// Convert Eigen VectorXd to Excel FP12 array as column vector
-_FP12* vector_to_fp(const Eigen::VectorXd& vec);
+// Arguments each calling cell last applied to a handle that is modified in
+// place. Excel recalculates cells when it chooses, so a cell that calls again
+// with the same arguments must not apply them a second time. Calls that do
+// not come from a cell, such as from a macro, are always applied.
+class applied_inputs {
+    std::map<OPER, std::vector<double>> last;
+public:
+    // True if caller already applied inputs
+    bool repeated(const OPER& caller, const std::vector<double>& inputs) const
+    {
+        const auto i = last.find(caller);
 
-// Convert Eigen VectorXd to Excel FP12 array as row vector
-_FP12* row_vector_to_fp(const Eigen::VectorXd& vec);
+        return i != last.end() && i->second == inputs;
+    }
+    void record(const OPER& caller, std::vector<double> inputs)
+    {
+        if (isRef(caller) || isSRef(caller)) {
+            last[caller] = std::move(inputs);
+        }
+    }
+};
 
 } // namespace xll
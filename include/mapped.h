@@ -0,0 +1,105 @@
+#pragma once
+// ==============================================================================
+// mapped.h - Out-of-core matrices in memory-mapped files
+// ==============================================================================
+// A tiled_matrix lives in a file mapped into the address space, so it can be
+// larger than the Excel grid, a single FP12 allocation, or physical memory.
+// The file is a 4096 byte header followed by tile × tile blocks of doubles in
+// row-major order of blocks, each block row-major and padded with zeros at the
+// right and bottom edges. A block is contiguous, so kernels that work a block
+// at a time touch few pages and the operating system streams the file through
+// the page cache.
+// ==============================================================================
+
+#include <cstdint>
+#include <filesystem>
+#include "linalg.h"
+
+namespace xll {
+
+// Read-write mapping of a whole file
+class mapped_file {
+    void* base = nullptr;
+    size_t length = 0;
+    std::filesystem::path key; // canonical path while registered as mapped
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    void close() noexcept;
+public:
+    // Create a zero-filled file of the given size, or map an existing file if size is 0.
+    // Creating a file that is already mapped would truncate it under the other
+    // mapping, so that throws.
+    mapped_file(const std::filesystem::path& path, size_t size);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    char* data() const
+    {
+        return static_cast<char*>(base);
+    }
+    size_t size() const
+    {
+        return length;
+    }
+};
+
+class tiled_matrix {
+    mapped_file file;
+    Eigen::Index rows_, cols_, tile_;
+    double* data_;
+public:
+    using block_map = Eigen::Map<RowMatrixXd, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+    // Default edge length of a block; 256 × 256 doubles is 512KB
+    static constexpr Eigen::Index default_tile = 256;
+
+    // Create a zero matrix in a new file
+    tiled_matrix(const std::filesystem::path& path, Eigen::Index rows, Eigen::Index cols, Eigen::Index tile = default_tile);
+    // Open an existing file
+    explicit tiled_matrix(const std::filesystem::path& path);
+
+    Eigen::Index rows() const
+    {
+        return rows_;
+    }
+    Eigen::Index cols() const
+    {
+        return cols_;
+    }
+    Eigen::Index tile() const
+    {
+        return tile_;
+    }
+    // Number of block rows and block columns
+    Eigen::Index block_rows() const
+    {
+        return (rows_ + tile_ - 1) / tile_;
+    }
+    Eigen::Index block_cols() const
+    {
+        return (cols_ + tile_ - 1) / tile_;
+    }
+
+    // Block (bi, bj) without its zero padding
+    block_map block(Eigen::Index bi, Eigen::Index bj) const;
+
+    // Copy rows × cols starting at (row0, col0) into or out of the file
+    void read(Eigen::Index row0, Eigen::Index col0, Eigen::Ref<RowMatrixXd> A) const;
+    void write(Eigen::Index row0, Eigen::Index col0, const Eigen::Ref<const RowMatrixXd>& A);
+};
+
+// C = A B block by block, in parallel over blocks of C
+void tiled_multiply(const tiled_matrix& A, const tiled_matrix& B, tiled_matrix& C);
+
+// A^T A in one pass over the block rows of A
+Eigen::MatrixXd tiled_gram(const tiled_matrix& A);
+
+// A x in one pass over A
+Eigen::VectorXd tiled_multiply(const tiled_matrix& A, const Eigen::Ref<const Eigen::VectorXd>& x);
+
+} // namespace xll
@@ -0,0 +1,66 @@
+#pragma once
+// ==============================================================================
+// masked.h - Ranges with missing data
+// ==============================================================================
+// XLL_FP arguments are rejected by Excel if any cell is blank or an error.
+// masked_matrix takes an LPOPER range instead and copies it in one pass over
+// the raw XLOPER12 cells into a dense row-major buffer and a validity bitmap.
+// Only numbers are valid. Invalid cells hold 0 so masked sums can run through
+// dense kernels unchanged.
+// ==============================================================================
+
+#include <cstdint>
+#include <vector>
+#include "linalg.h"
+
+namespace xll {
+
+class masked_matrix {
+    RowMatrixXd values_;
+    std::vector<uint64_t> bits_;
+
+public:
+    explicit masked_matrix(const XLOPER12& x);
+
+    Eigen::Index rows() const
+    {
+        return values_.rows();
+    }
+    Eigen::Index cols() const
+    {
+        return values_.cols();
+    }
+
+    // Cell values with 0 for invalid cells
+    const RowMatrixXd& values() const
+    {
+        return values_;
+    }
+
+    bool valid(Eigen::Index i, Eigen::Index j) const
+    {
+        const size_t k = static_cast<size_t>(i * cols() + j);
+
+        return (bits_[k >> 6] >> (k & 63)) & 1;
+    }
+
+    // True if every cell of row i is valid
+    bool complete(Eigen::Index i) const;
+
+    // Number of valid cells
+    Eigen::Index count() const;
+
+    // 1 for valid cells, 0 otherwise
+    RowMatrixXd mask() const;
+};
+
+// Covariance (or correlation) of each pair of columns over the rows where both
+// are valid. Pairs with fewer than two such rows are NaN.
+Eigen::MatrixXd pairwise_covariance(const masked_matrix& X, bool correlation = false);
+
+// Least squares coefficients of y on the columns of X, preceded by the
+// intercept if requested, over the rows where y and all of X are valid.
+// Returns the coefficients and sets used to the number of rows kept.
+Eigen::VectorXd masked_regress(const masked_matrix& y, const masked_matrix& X, bool intercept, Eigen::Index& used);
+
+} // namespace xll
@@ -0,0 +1,83 @@
+#pragma once
+// ==============================================================================
+// regress.h - Linear regression
+// ==============================================================================
+// regress_stream is square-root recursive least squares: it keeps the upper
+// triangular factor R of the augmented design [X y], so
+//     R = [R_x  z]
+//         [0    ρ]
+// gives β = R_x^-1 z and residual sum of squares ρ². Each observation is one
+// O(p²) Givens update and the state does not grow with history.
+//
+// regress fits many responses against one design matrix. The column-pivoted
+// QR factorization is computed once and shared by all response columns.
+// ==============================================================================
+
+#include <deque>
+#include "linalg.h"
+
+namespace xll {
+
+class regress_stream {
+    Eigen::Index p;          // regressors including the intercept
+    bool intercept;
+    double lambda;           // forgetting factor in (0, 1]
+    Eigen::Index window;     // rows kept, or 0 for all
+    RowMatrixXd R;           // (p+1)×(p+1) factor of [X y]
+    std::deque<Eigen::RowVectorXd> rows; // augmented rows in the window
+    double weight = 0;       // Σ λ^age, the effective number of observations
+    Eigen::Index refactored = 0;
+
+    void refactor();
+public:
+    // lambda < 1 discounts older rows geometrically. window > 0 keeps only the
+    // latest window rows and needs lambda = 1.
+    regress_stream(Eigen::Index regressors, double lambda = 1, Eigen::Index window = 0, bool intercept = true);
+
+    // Add the rows of X with responses y
+    void add(const Eigen::Ref<const RowMatrixXd>& X, const Eigen::Ref<const Eigen::VectorXd>& y);
+
+    Eigen::Index size() const
+    {
+        return p;
+    }
+    // Σ λ^age over the rows added
+    double observations() const
+    {
+        return weight;
+    }
+    // Number of window downdates that rebuilt R from the stored rows
+    Eigen::Index refactorizations() const
+    {
+        return refactored;
+    }
+
+    // Coefficients with the intercept first
+    Eigen::VectorXd coefficients() const;
+    // Residual sum of squares over observations() - size() degrees of freedom
+    double variance() const;
+    // Standard errors of the coefficients in O(p³)
+    Eigen::VectorXd errors() const;
+
+    // Rows last added by each calling cell
+    applied_inputs applied;
+};
+
+// Weighted least squares fit of each column of Y
+struct regression {
+    Eigen::MatrixXd coefficients; // p×q with the intercept first
+    Eigen::MatrixXd errors;       // p×q standard errors, NaN for dropped columns
+    Eigen::RowVectorXd r2;        // coefficient of determination of each response
+    Eigen::RowVectorXd f;         // F statistic against the intercept-only model
+    Eigen::RowVectorXd sigma;     // residual standard error
+    Eigen::MatrixXd residuals;    // m×q unweighted residuals y - Xβ
+    Eigen::Index rank = 0;        // numerical rank of the weighted design
+    double dof = 0;               // residual degrees of freedom
+};
+
+// Regress the columns of Y(m×q) on X(m×k) with optional nonnegative weights w
+// (nullptr for unit weights). Response columns are solved on linalg_pool().
+regression regress(const Eigen::Ref<const RowMatrixXd>& X, const Eigen::Ref<const RowMatrixXd>& Y,
+    const double* w, bool intercept);
+
+} // namespace xll
@@ -0,0 +1,105 @@
+#pragma once
+// ==============================================================================
+// sparse.h - Sparse matrix handles and sparse direct solvers
+// ==============================================================================
+// Sparse matrices are held in compressed column storage by handle<sparse_matrix>.
+// Memory and the cost of products and factorizations scale with the number of
+// nonzeros rather than n². Sparse factorizations implement the factor interface
+// so MATRIX.FACTOR.SOLVE works on them unchanged.
+// ==============================================================================
+
+#include "factor.h"
+
+// Suppress warnings from Eigen library headers (external code)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#elif defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wnull-dereference"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#endif
+
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+#include <Eigen/SparseQR>
+#include <Eigen/OrderingMethods>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#elif defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+namespace xll {
+
+// Compressed column storage held by handle<sparse_matrix>
+using sparse_matrix = Eigen::SparseMatrix<double>;
+
+// Build from a k×3 array of 1-based (row, column, value) triplets.
+// Duplicate entries are summed. Zero rows or cols are inferred from the indices.
+sparse_matrix sparse_from_triplets(const _FP12* triplets, Eigen::Index rows = 0, Eigen::Index cols = 0);
+
+// Build from a dense array keeping entries with |a| > tol
+sparse_matrix sparse_from_dense(const Eigen::Ref<const RowMatrixXd>& A, double tol = 0);
+
+// Return nnz×3 array of 1-based (row, column, value) triplets in column order
+_FP12* sparse_to_triplets(const sparse_matrix& A);
+
+// ==============================================================================
+// Sparse Factorizations
+// ==============================================================================
+// Triangular factors are not exported since their dense form is O(n²).
+// U() and V() are empty.
+
+// P A P^T = L L^T with approximate minimum degree ordering
+class sparse_chol_factor : public factor {
+    Eigen::SimplicialLLT<sparse_matrix> llt;
+public:
+    explicit sparse_chol_factor(const sparse_matrix& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// P_r A P_c = L U with column approximate minimum degree ordering
+class sparse_lu_factor : public factor {
+    Eigen::SparseLU<sparse_matrix, Eigen::COLAMDOrdering<int>> lu;
+public:
+    explicit sparse_lu_factor(const sparse_matrix& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+// A P = Q R for least squares
+class sparse_qr_factor : public factor {
+    Eigen::SparseQR<sparse_matrix, Eigen::COLAMDOrdering<int>> qr;
+public:
+    explicit sparse_qr_factor(const sparse_matrix& A);
+
+    Eigen::Index rows() const override;
+    Eigen::Index cols() const override;
+    Eigen::MatrixXd solve(const Eigen::MatrixXd& b) const override;
+    Eigen::MatrixXd U() const override;
+    Eigen::MatrixXd V() const override;
+    Eigen::VectorXd values() const override;
+    double logdet() const override;
+};
+
+} // namespace xll
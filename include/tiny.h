@@ -0,0 +1,96 @@
+#pragma once
+// ==============================================================================
+// tiny.h - Fixed-size kernels for small square matrices
+// ==============================================================================
+// Eigen::Matrix<double, N, N> lives on the stack and its loops are unrolled at
+// compile time. Eigen inverts and takes determinants in closed form for N ≤ 4
+// and uses fixed-size LU and Cholesky above that. Nothing is allocated except
+// the thread-local result buffer, which is reused while the shape is unchanged.
+// ==============================================================================
+
+#include <type_traits>
+#include "linalg.h"
+
+namespace xll {
+
+// Sizes with fixed-size kernels
+inline constexpr Eigen::Index tiny_min = 2;
+inline constexpr Eigen::Index tiny_max = 6;
+
+template<int N>
+using tiny_matrix = Eigen::Matrix<double, N, N, Eigen::RowMajor>;
+
+// Call f(std::integral_constant<int, n>{}) and return true if tiny_min ≤ n ≤ tiny_max
+template<class F>
+inline bool tiny_dispatch(Eigen::Index n, F&& f)
+{
+    switch (n) {
+    case 2:
+        f(std::integral_constant<int, 2>{});
+        return true;
+    case 3:
+        f(std::integral_constant<int, 3>{});
+        return true;
+    case 4:
+        f(std::integral_constant<int, 4>{});
+        return true;
+    case 5:
+        f(std::integral_constant<int, 5>{});
+        return true;
+    case 6:
+        f(std::integral_constant<int, 6>{});
+        return true;
+    }
+
+    return false;
+}
+
+template<int N>
+inline _FP12* tiny_inverse(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    const tiny_matrix<N> a = A;
+    _FP12* result = fp_alloc(N, N);
+    Eigen::Map<tiny_matrix<N>>(result->array) = a.inverse();
+
+    return result;
+}
+
+template<int N>
+inline double tiny_determinant(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    const tiny_matrix<N> a = A;
+
+    return a.determinant();
+}
+
+// x = A^-1 b for b(N×p)
+template<int N>
+inline _FP12* tiny_solve(const Eigen::Ref<const RowMatrixXd>& A, const Eigen::Ref<const RowMatrixXd>& b)
+{
+    const tiny_matrix<N> a = A;
+    const Eigen::PartialPivLU<Eigen::Matrix<double, N, N>> lu(a);
+    _FP12* result = fp_alloc(N, b.cols());
+    for (Eigen::Index j = 0; j < b.cols(); ++j) {
+        const Eigen::Matrix<double, N, 1> x = lu.solve(Eigen::Matrix<double, N, 1>(b.col(j)));
+        fp_out(result).col(j) = x;
+    }
+
+    return result;
+}
+
+// Lower triangular L with A = L L^T, or nullptr if A is not positive definite
+template<int N>
+inline _FP12* tiny_cholesky(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    const Eigen::LLT<tiny_matrix<N>> llt(A);
+    if (llt.info() != Eigen::Success) {
+        return nullptr;
+    }
+
+    _FP12* result = fp_alloc(N, N);
+    Eigen::Map<tiny_matrix<N>>(result->array) = llt.matrixL();
+
+    return result;
+}
+
+} // namespace xll
@@ -0,0 +1,42 @@
+#pragma once
+// ==============================================================================
+// topk.h - Truncated SVD and eigendecompositions
+// ==============================================================================
+// Only the leading k factors are computed, in O(mnk) rather than the
+// O(mn·min(m,n)) of a full decomposition. Randomized range finding works on any
+// matrix; Lanczos applies to symmetric matrices.
+// ==============================================================================
+
+#include <cstdint>
+#include "linalg.h"
+
+namespace xll {
+
+// A ≈ U diag(s) V^T with U(m×k), s(k), V(n×k)
+struct truncated_svd {
+    Eigen::MatrixXd U;
+    Eigen::VectorXd s;
+    Eigen::MatrixXd V;
+};
+
+// A X ≈ X diag(λ) with X(n×k) ordered by decreasing |λ|
+struct truncated_eig {
+    Eigen::VectorXd values;
+    Eigen::MatrixXd vectors;
+};
+
+// Randomized range finder (Halko, Martinsson, Tropp) with power iterations
+// and oversampling. The same seed gives the same result.
+truncated_svd randomized_svd(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Index k,
+    uint64_t seed = 0, int power = 2, Eigen::Index oversample = 10);
+
+// Randomized eigendecomposition of a symmetric matrix
+truncated_eig randomized_eig(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Index k,
+    uint64_t seed = 0, int power = 2, Eigen::Index oversample = 10);
+
+// Lanczos with full reorthogonalization for a symmetric matrix. Iterates until the
+// Ritz residuals of the k largest magnitude eigenvalues are below tol·|λ_1|.
+truncated_eig lanczos_eig(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Index k,
+    uint64_t seed = 0, double tol = 1e-10);
+
+} // namespace xll
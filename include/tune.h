@@ -0,0 +1,26 @@
+#pragma once
+// ==============================================================================
+// tune.h - Kernel autotuner
+// ==============================================================================
+// Times the candidate kernels of MATRIX.* functions on the host CPU and stores
+// the crossover sizes in linalg_thresholds(). The first load of the add-in
+// measures them and saves them next to the XLL so later loads only read a file.
+// ==============================================================================
+
+#include <filesystem>
+#include "linalg.h"
+
+namespace xll {
+
+// Measure every crossover and store it in linalg_thresholds()
+void autotune();
+
+// The add-in path with extension .tune
+std::filesystem::path thresholds_file();
+
+// Read key=value lines. Returns false and changes nothing unless every
+// threshold is found with a positive integer value.
+bool load_thresholds(const std::filesystem::path& file);
+bool save_thresholds(const std::filesystem::path& file);
+
+} // namespace xll
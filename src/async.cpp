@@ -0,0 +1,726 @@
+// ==============================================================================
+// async.cpp - Worker pool for asynchronous LINALG functions
+// ==============================================================================
+// MATRIX.*.ASYNC variants run the synchronous LINALG kernels on linalg_pool().
+// Kernels write to thread-local result buffers so workers never share output.
+// ==============================================================================
+
+#include <exception>
+#include <unordered_map>
+#include "async.h"
+#include "cache.h"
+
+using namespace xll;
+
+// ==============================================================================
+// Work-Stealing Pool
+// ==============================================================================
+
+namespace {
+
+    // Pool and queue index of the current thread if it is a worker
+    thread_local const work_pool* current_pool = nullptr;
+    thread_local size_t current_queue = 0;
+
+} // namespace
+
+work_pool::work_pool(unsigned n, size_t capacity_)
+    : capacity(capacity_)
+{
+    if (n == 0) {
+        n = std::thread::hardware_concurrency();
+        n = n > 1 ? n - 1 : 1;
+    }
+
+    for (unsigned i = 0; i < n; ++i) {
+        queues.emplace_back(std::make_unique<queue>());
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        workers.emplace_back(&work_pool::run, this, i);
+    }
+}
+
+work_pool::~work_pool()
+{
+    stop();
+}
+
+bool work_pool::submit(task t)
+{
+    if (queued.load() >= capacity) {
+        return false;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        if (stopping) {
+            return false;
+        }
+        // Count before pushing so pop never sees a task that is not counted
+        ++queued;
+    }
+
+    // Workers push to their own deque, other threads round robin
+    const size_t i = current_pool == this ? current_queue : next++ % queues.size();
+    {
+        std::lock_guard lock(queues[i]->mutex);
+        queues[i]->tasks.push_back(std::move(t));
+    }
+    ready.notify_one();
+
+    return true;
+}
+
+bool work_pool::pop(size_t i, task& t)
+{
+    // Newest task from our own deque
+    {
+        std::lock_guard lock(queues[i]->mutex);
+        if (!queues[i]->tasks.empty()) {
+            t = std::move(queues[i]->tasks.back());
+            queues[i]->tasks.pop_back();
+            --queued;
+
+            return true;
+        }
+    }
+
+    // Oldest task from another deque
+    for (size_t k = 1; k < queues.size(); ++k) {
+        queue& q = *queues[(i + k) % queues.size()];
+        std::lock_guard lock(q.mutex);
+        if (!q.tasks.empty()) {
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            --queued;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void work_pool::run(size_t i)
+{
+    current_pool = this;
+    current_queue = i;
+
+    // Checked before every pop so stop() discards what is still queued
+    task t;
+    while (!stopping) {
+        if (pop(i, t)) {
+            try {
+                t();
+            }
+            catch (...) {
+                // tasks report their own errors
+            }
+            t = nullptr;
+
+            continue;
+        }
+
+        std::unique_lock lock(mutex);
+        ready.wait(lock, [this] { return stopping || queued.load() > 0; });
+    }
+}
+
+void work_pool::stop()
+{
+    {
+        std::lock_guard lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    ready.notify_all();
+
+    for (auto& w : workers) {
+        if (w.joinable()) {
+            w.join();
+        }
+    }
+    for (auto& q : queues) {
+        q->tasks.clear();
+    }
+    queued = 0;
+}
+
+unsigned work_pool::threads() const
+{
+    return static_cast<unsigned>(workers.size());
+}
+
+size_t work_pool::pending() const
+{
+    return queued.load();
+}
+
+work_pool& xll::linalg_pool()
+{
+    static work_pool pool;
+
+    return pool;
+}
+
+namespace {
+
+    // Chunks are claimed from next by the caller and any helper that starts
+    // before they run out. Late helpers find nothing left and only touch this.
+    struct parallel_state {
+        std::function<void(Eigen::Index, Eigen::Index)> f;
+        Eigen::Index n, grain, chunks;
+        std::atomic<Eigen::Index> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+        Eigen::Index done = 0;
+        std::exception_ptr error;
+
+        void run()
+        {
+            Eigen::Index c;
+            while ((c = next++) < chunks) {
+                try {
+                    f(c * grain, (std::min)(n, (c + 1) * grain));
+                }
+                catch (...) {
+                    std::lock_guard lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+
+                std::lock_guard lock(mutex);
+                if (++done == chunks) {
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+
+} // namespace
+
+void xll::parallel_for(Eigen::Index n, Eigen::Index grain, const std::function<void(Eigen::Index, Eigen::Index)>& f)
+{
+    auto& pool = linalg_pool();
+    const Eigen::Index ways = static_cast<Eigen::Index>(pool.threads()) + 1;
+
+    grain = (std::max)(grain, (n + ways - 1) / ways);
+    if (grain <= 0 || n <= grain) {
+        if (n > 0) {
+            f(0, n);
+        }
+
+        return;
+    }
+
+    auto state = std::make_shared<parallel_state>();
+    state->f = f;
+    state->n = n;
+    state->grain = grain;
+    state->chunks = (n + grain - 1) / grain;
+
+    for (Eigen::Index i = 1; i < state->chunks; ++i) {
+        if (!pool.submit([state] { state->run(); })) {
+            break;
+        }
+    }
+    state->run();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->chunks; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+// Join workers before Excel unloads the add-in
+Auto<Close> xac_linalg_pool([]() {
+    linalg_pool().stop();
+
+    return TRUE;
+});
+
+// ==============================================================================
+// Asynchronous Calls
+// ==============================================================================
+
+namespace {
+
+    // Arguments of an in-flight call and the async handles waiting on it
+    struct call {
+        std::vector<double> inputs;
+        std::vector<OPER> handles;
+    };
+
+    std::mutex calls_mutex;
+    std::unordered_map<uint64_t, call> in_flight;
+
+    std::atomic<unsigned long long> submitted{ 0 };
+    std::atomic<unsigned long long> coalesced{ 0 };
+    std::atomic<unsigned long long> inlined{ 0 };
+
+    // Copy a kernel result into an OPER for xlAsyncReturn
+    OPER fp_to_oper(const _FP12* fp)
+    {
+        if (!fp) {
+            return OPER(ErrNum);
+        }
+
+        OPER o(fp->rows, fp->columns);
+        for (int i = 0; i < xll::size(*fp); ++i) {
+            o[i] = fp->array[i];
+        }
+
+        return o;
+    }
+
+} // namespace
+
+void xll::excel_async_return(const XLOPER12& handle, const XLOPER12& result)
+{
+    Excel(xlAsyncReturn, handle, result);
+}
+
+void xll::async_call(uint64_t key, std::vector<double> inputs, const XLOPER12& handle, std::function<OPER()> f)
+{
+    // Allocate before registering so a throw leaves no handle waiting
+    auto pf = std::make_shared<std::function<OPER()>>(std::move(f));
+    auto shared = std::make_shared<bool>(true); // registered in in_flight
+    const work_pool::task job = [key, pf, shared, self = OPER(handle)]() {
+        OPER result;
+        try {
+            result = (*pf)();
+        }
+        catch (...) {
+            result = ErrNum;
+        }
+
+        std::vector<OPER> handles;
+        if (*shared) {
+            std::lock_guard lock(calls_mutex);
+            auto i = in_flight.find(key);
+            handles = std::move(i->second.handles);
+            in_flight.erase(i);
+        }
+        else {
+            handles.push_back(self);
+        }
+        for (const auto& h : handles) {
+            try {
+                async_return(h, result);
+            }
+            catch (...) {
+                // Excel discarded the call
+            }
+        }
+    };
+
+    {
+        std::lock_guard lock(calls_mutex);
+
+        auto [i, inserted] = in_flight.try_emplace(key);
+        if (inserted) {
+            try {
+                i->second.handles.emplace_back(handle);
+            }
+            catch (...) {
+                in_flight.erase(i);
+                throw;
+            }
+            i->second.inputs = std::move(inputs);
+        }
+        else if (i->second.inputs == inputs) {
+            i->second.handles.emplace_back(handle);
+            ++coalesced;
+
+            return;
+        }
+        else {
+            // Same key but different arguments, so compute it separately
+            *shared = false;
+        }
+    }
+    ++submitted;
+
+    bool queued = false;
+    try {
+        queued = linalg_pool().submit(job);
+    }
+    catch (...) {
+        // Run it here so the registered handles are answered
+    }
+    if (!queued) {
+        ++inlined;
+        job();
+    }
+}
+
+async_counters xll::async_stats(bool reset)
+{
+    const async_counters c{ submitted.load(), coalesced.load(), inlined.load() };
+    if (reset) {
+        submitted = 0;
+        coalesced = 0;
+        inlined = 0;
+    }
+
+    return c;
+}
+
+// ==============================================================================
+// Asynchronous LINALG Functions (9 functions)
+// ==============================================================================
+
+// Synchronous kernels from linalg.cpp
+#if defined(__GNUC__) || defined(__clang__)
+extern "C" {
+#endif
+_FP12* WINAPI xll_matrix_mul(_FP12* pa, _FP12* pb);
+_FP12* WINAPI xll_matrix_inv(_FP12* pa);
+_FP12* WINAPI xll_matrix_svd_full(_FP12* pa);
+_FP12* WINAPI xll_matrix_eigenvalues(_FP12* pa);
+_FP12* WINAPI xll_matrix_eigenvectors(_FP12* pa);
+_FP12* WINAPI xll_matrix_solve(_FP12* pa, _FP12* pb);
+_FP12* WINAPI xll_matrix_lstsq(_FP12* pa, _FP12* pb);
+_FP12* WINAPI xll_matrix_pinv(_FP12* pa);
+#if defined(__GNUC__) || defined(__clang__)
+}
+#endif
+
+namespace {
+
+    using unary_kernel = _FP12* (WINAPI*)(_FP12*);
+    using binary_kernel = _FP12* (WINAPI*)(_FP12*, _FP12*);
+
+    // Dimensions and elements of an argument, compared before coalescing
+    void append_input(std::vector<double>& inputs, const _FP12* fp)
+    {
+        inputs.push_back(fp->rows);
+        inputs.push_back(fp->columns);
+        inputs.insert(inputs.end(), fp->array, fp->array + xll::size(*fp));
+    }
+
+    // Arguments are copied since Excel frees them when the call returns
+    void async_kernel(unary_kernel f, const _FP12* pa, const XLOPER12& handle)
+    {
+        const uint64_t key = fp_hash(reinterpret_cast<uintptr_t>(f), pa);
+        std::vector<double> inputs;
+        append_input(inputs, pa);
+
+        async_call(key, std::move(inputs), handle, [f, a = FPX(*pa)]() mutable {
+            return fp_to_oper(f(a.get()));
+        });
+    }
+    void async_kernel(binary_kernel f, const _FP12* pa, const _FP12* pb, const XLOPER12& handle)
+    {
+        const uint64_t key = fp_hash(fp_hash(reinterpret_cast<uintptr_t>(f), pa), pb);
+        std::vector<double> inputs;
+        append_input(inputs, pa);
+        append_input(inputs, pb);
+
+        async_call(key, std::move(inputs), handle, [f, a = FPX(*pa), b = FPX(*pb)]() mutable {
+            return fp_to_oper(f(a.get(), b.get()));
+        });
+    }
+
+    // Answer an async call that could not be started
+    void async_error(const XLOPER12& handle)
+    {
+        try {
+            async_return(handle, OPER(ErrNum));
+        }
+        catch (...) {
+            // Excel discarded the call
+        }
+    }
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// MATRIX.MUL.ASYNC - Asynchronous matrix multiplication
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_mul_async(
+    Function(XLL_VOID, "xll_matrix_mul_async", "MATRIX.MUL.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the first matrix."),
+        Arg(XLL_FP, "B", "is the second matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Multiply two matrices on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.MUL. Excel keeps calculating while the product is computed.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_mul_async(_FP12* pa, _FP12* pb, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_mul, pa, pb, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.INVERSE.ASYNC - Asynchronous matrix inverse
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_inv_async(
+    Function(XLL_VOID, "xll_matrix_inv_async", "MATRIX.INVERSE.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square invertible matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Compute the inverse of a square matrix on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.INVERSE.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_inv_async(_FP12* pa, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_inv, pa, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SVD_FULL.ASYNC - Asynchronous full SVD
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_svd_full_async(
+    Function(XLL_VOID, "xll_matrix_svd_full_async", "MATRIX.SVD_FULL.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Compute full SVD decomposition on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.SVD_FULL.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_svd_full_async(_FP12* pa, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_svd_full, pa, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.EIGENVALUES.ASYNC - Asynchronous eigenvalues
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_eigenvalues_async(
+    Function(XLL_VOID, "xll_matrix_eigenvalues_async", "MATRIX.EIGENVALUES.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Compute eigenvalues of a square matrix on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.EIGENVALUES.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_eigenvalues_async(_FP12* pa, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_eigenvalues, pa, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.EIGENVECTORS.ASYNC - Asynchronous eigenvectors
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_eigenvectors_async(
+    Function(XLL_VOID, "xll_matrix_eigenvectors_async", "MATRIX.EIGENVECTORS.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Compute eigenvectors of a square matrix on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.EIGENVECTORS.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_eigenvectors_async(_FP12* pa, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_eigenvectors, pa, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SOLVE.ASYNC - Asynchronous linear solve
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_solve_async(
+    Function(XLL_VOID, "xll_matrix_solve_async", "MATRIX.SOLVE.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square coefficient matrix."),
+        Arg(XLL_FP, "b", "is the right-hand side vector or matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Solve linear system Ax = b on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.SOLVE.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_solve_async(_FP12* pa, _FP12* pb, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_solve, pa, pb, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.LSTSQ.ASYNC - Asynchronous least squares
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_lstsq_async(
+    Function(XLL_VOID, "xll_matrix_lstsq_async", "MATRIX.LSTSQ.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the coefficient matrix."),
+        Arg(XLL_FP, "b", "is the right-hand side vector.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Solve overdetermined system in least squares sense on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.LSTSQ.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_lstsq_async(_FP12* pa, _FP12* pb, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_lstsq, pa, pb, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.PSEUDO_INV.ASYNC - Asynchronous pseudoinverse
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_pinv_async(
+    Function(XLL_VOID, "xll_matrix_pinv_async", "MATRIX.PSEUDO_INV.ASYNC")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix.")
+    })
+    .Asynchronous()
+    .FunctionHelp("Compute Moore-Penrose pseudoinverse on the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Asynchronous MATRIX.PSEUDO_INV.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+void WINAPI xll_matrix_pinv_async(_FP12* pa, LPOPER phandle)
+{
+#pragma XLLEXPORT
+    try {
+        async_kernel(xll_matrix_pinv, pa, *phandle);
+    }
+    catch (...) {
+        async_error(*phandle);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.ASYNC.STATS - Worker pool counters
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_async_stats(
+    Function(XLL_FP, "xll_matrix_async_stats", "MATRIX.ASYNC.STATS")
+    .Arguments({
+        Arg(XLL_LPOPER, "reset", "is an optional boolean to reset the counters after reading them.")
+    })
+    .ThreadSafe()
+    .Volatile()
+    .FunctionHelp("Return threads, pending, submitted, coalesced, and inlined counts of the LINALG worker pool.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Submitted counts computations queued on the pool, coalesced counts calls that
+shared an identical in-flight computation, and inlined counts computations run on
+the calling thread because the queue was full.</p>
+<p><b>Output:</b> Row vector {threads, pending, submitted, coalesced, inlined} (1×5)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_async_stats(LPOPER preset)
+{
+#pragma XLLEXPORT
+    try {
+        const auto c = async_stats(static_cast<bool>(*preset));
+        const double stats[5] = {
+            static_cast<double>(linalg_pool().threads()),
+            static_cast<double>(linalg_pool().pending()),
+            static_cast<double>(c.submitted),
+            static_cast<double>(c.coalesced),
+            static_cast<double>(c.inlined)
+        };
+
+        return row_vector_to_fp(Eigen::Map<const Eigen::VectorXd>(stats, 5));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,407 @@
+// ==============================================================================
+// batch.cpp - Batched kernels for many small matrices
+// ==============================================================================
+// MATRIX.BATCH.INVERSE, .SOLVE, .DET and .CHOLESKY process k stacked blocks in
+// one call, so call overhead is paid once instead of once per block.
+// ==============================================================================
+
+#include <cmath>
+#include <limits>
+#include "batch.h"
+#include "async.h"
+
+using namespace xll;
+using namespace Eigen;
+
+namespace {
+
+    // Matrices per structure-of-arrays chunk
+    constexpr Index chunk = 256;
+
+    // Check that A holds k stacked square blocks and return k
+    Index blocks(const Eigen::Ref<const RowMatrixXd>& A)
+    {
+        const Index n = A.cols();
+        ensure(n > 0 && A.rows() % n == 0);
+
+        return A.rows() / n;
+    }
+
+    // Call f(m0, m1) on chunks of at most chunk blocks, in parallel
+    template<class F>
+    void for_chunks(Index k, F&& f)
+    {
+        parallel_for(k, chunk, [&](Index b, Index e) {
+            for (Index m = b; m < e; m += chunk) {
+                f(m, (std::min)(e, m + chunk));
+            }
+        });
+    }
+
+    // Gaussian elimination with partial pivoting on blocks [m0, m1) augmented
+    // with p right-hand side columns from B, or the identity if B is null.
+    // Writes solutions to X and determinants to d when they are not null.
+    void lu_chunk(const Eigen::Ref<const RowMatrixXd>& A, const Eigen::Ref<const RowMatrixXd>* B,
+        Eigen::Ref<RowMatrixXd>* X, Eigen::Ref<VectorXd>* d, Index m0, Index m1)
+    {
+        const Index n = A.cols();
+        const Index p = B ? B->cols() : (X ? n : 0);
+        const Index w = n + p;
+        const Index lanes = m1 - m0;
+
+        // Column i·w + c holds entry (i,c) of the augmented matrix of every block
+        ArrayXXd S(lanes, n * w);
+        const auto at = [&](Index i, Index c) { return S.col(i * w + c); };
+
+        for (Index l = 0; l < lanes; ++l) {
+            const Index r = (m0 + l) * n;
+            for (Index i = 0; i < n; ++i) {
+                for (Index j = 0; j < n; ++j) {
+                    S(l, i * w + j) = A(r + i, j);
+                }
+                for (Index c = 0; c < p; ++c) {
+                    S(l, i * w + n + c) = B ? (*B)(r + i, c) : static_cast<double>(i == c);
+                }
+            }
+        }
+
+        ArrayXd sign = ArrayXd::Ones(lanes);
+        for (Index j = 0; j < n; ++j) {
+            // Bring the largest |a(r,j)| of each block to row j with masked swaps
+            for (Index r = j + 1; r < n; ++r) {
+                const Array<bool, Dynamic, 1> swap = at(r, j).abs() > at(j, j).abs();
+                if (!swap.any()) {
+                    continue;
+                }
+                for (Index c = j; c < w; ++c) {
+                    const ArrayXd t = swap.select(at(r, c), at(j, c));
+                    at(r, c) = swap.select(at(j, c), at(r, c));
+                    at(j, c) = t;
+                }
+                sign = swap.select(-sign, sign);
+            }
+
+            // Singular blocks have a zero column below the pivot and skip elimination
+            const ArrayXd pivot = at(j, j);
+            for (Index r = j + 1; r < n; ++r) {
+                const ArrayXd f = (pivot != 0).select(at(r, j) / pivot, 0.);
+                for (Index c = j + 1; c < w; ++c) {
+                    at(r, c) -= f * at(j, c);
+                }
+            }
+        }
+
+        if (d) {
+            for (Index j = 0; j < n; ++j) {
+                sign *= at(j, j);
+            }
+            d->segment(m0, lanes) = sign.matrix();
+        }
+
+        if (X) {
+            // Back substitution overwrites the right-hand sides with the solutions
+            for (Index i = n - 1; i >= 0; --i) {
+                for (Index c = n; c < w; ++c) {
+                    for (Index q = i + 1; q < n; ++q) {
+                        at(i, c) -= at(i, q) * at(q, c);
+                    }
+                    at(i, c) /= at(i, i);
+                }
+            }
+
+            for (Index l = 0; l < lanes; ++l) {
+                const Index r = (m0 + l) * n;
+                for (Index i = 0; i < n; ++i) {
+                    for (Index c = 0; c < p; ++c) {
+                        (*X)(r + i, c) = S(l, i * w + n + c);
+                    }
+                }
+            }
+        }
+    }
+
+    // Cholesky–Crout on blocks [m0, m1)
+    void cholesky_chunk(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<RowMatrixXd>& L, Index m0, Index m1)
+    {
+        const Index n = A.cols();
+        const Index lanes = m1 - m0;
+
+        ArrayXXd S(lanes, n * n);
+        const auto at = [&](Index i, Index j) { return S.col(i * n + j); };
+
+        for (Index l = 0; l < lanes; ++l) {
+            const Index r = (m0 + l) * n;
+            for (Index i = 0; i < n; ++i) {
+                for (Index j = 0; j <= i; ++j) {
+                    S(l, i * n + j) = A(r + i, j);
+                }
+            }
+        }
+
+        // NaN propagates from a nonpositive pivot to the rest of the block
+        for (Index j = 0; j < n; ++j) {
+            for (Index q = 0; q < j; ++q) {
+                at(j, j) -= at(j, q).square();
+            }
+            at(j, j) = (at(j, j) > 0).select(at(j, j).sqrt(), std::numeric_limits<double>::quiet_NaN());
+
+            for (Index i = j + 1; i < n; ++i) {
+                for (Index q = 0; q < j; ++q) {
+                    at(i, j) -= at(i, q) * at(j, q);
+                }
+                at(i, j) /= at(j, j);
+            }
+        }
+
+        for (Index l = 0; l < lanes; ++l) {
+            const Index r = (m0 + l) * n;
+            const bool ok = !std::isnan(S(l, n * n - 1));
+            for (Index i = 0; i < n; ++i) {
+                for (Index j = 0; j < n; ++j) {
+                    L(r + i, j) = !ok ? std::numeric_limits<double>::quiet_NaN() : j <= i ? S(l, i * n + j) : 0.;
+                }
+            }
+        }
+    }
+
+} // namespace
+
+void xll::batch_solve(const Eigen::Ref<const RowMatrixXd>& A, const Eigen::Ref<const RowMatrixXd>& B, Eigen::Ref<RowMatrixXd> X)
+{
+    const Index n = A.cols();
+    const Index k = blocks(A);
+    ensure(B.rows() == A.rows() && X.rows() == B.rows() && X.cols() == B.cols());
+
+    if (n <= batch_soa_max) {
+        for_chunks(k, [&](Index m0, Index m1) { lu_chunk(A, &B, &X, nullptr, m0, m1); });
+    }
+    else {
+        parallel_for(k, 1, [&](Index b, Index e) {
+            for (Index m = b; m < e; ++m) {
+                PartialPivLU<MatrixXd> lu(A.middleRows(m * n, n));
+                X.middleRows(m * n, n) = lu.solve(B.middleRows(m * n, n));
+            }
+        });
+    }
+}
+
+void xll::batch_inverse(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<RowMatrixXd> X)
+{
+    const Index n = A.cols();
+    const Index k = blocks(A);
+    ensure(X.rows() == A.rows() && X.cols() == n);
+
+    if (n <= batch_soa_max) {
+        for_chunks(k, [&](Index m0, Index m1) { lu_chunk(A, nullptr, &X, nullptr, m0, m1); });
+    }
+    else {
+        parallel_for(k, 1, [&](Index b, Index e) {
+            for (Index m = b; m < e; ++m) {
+                PartialPivLU<MatrixXd> lu(A.middleRows(m * n, n));
+                X.middleRows(m * n, n) = lu.inverse();
+            }
+        });
+    }
+}
+
+void xll::batch_determinant(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<VectorXd> d)
+{
+    const Index n = A.cols();
+    const Index k = blocks(A);
+    ensure(d.size() == k);
+
+    if (n <= batch_soa_max) {
+        for_chunks(k, [&](Index m0, Index m1) { lu_chunk(A, nullptr, nullptr, &d, m0, m1); });
+    }
+    else {
+        parallel_for(k, 1, [&](Index b, Index e) {
+            for (Index m = b; m < e; ++m) {
+                d(m) = PartialPivLU<MatrixXd>(A.middleRows(m * n, n)).determinant();
+            }
+        });
+    }
+}
+
+void xll::batch_cholesky(const Eigen::Ref<const RowMatrixXd>& A, Eigen::Ref<RowMatrixXd> L)
+{
+    const Index n = A.cols();
+    const Index k = blocks(A);
+    ensure(L.rows() == A.rows() && L.cols() == n);
+
+    if (n <= batch_soa_max) {
+        for_chunks(k, [&](Index m0, Index m1) { cholesky_chunk(A, L, m0, m1); });
+    }
+    else {
+        parallel_for(k, 1, [&](Index b, Index e) {
+            for (Index m = b; m < e; ++m) {
+                LLT<MatrixXd> llt(A.middleRows(m * n, n));
+                if (llt.info() == Success) {
+                    L.middleRows(m * n, n) = llt.matrixL();
+                }
+                else {
+                    L.middleRows(m * n, n).setConstant(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+        });
+    }
+}
+
+// ==============================================================================
+// Batched Functions (4 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.BATCH.INVERSE - Inverse of each stacked block
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_batch_inverse(
+    Function(XLL_FP, "xll_matrix_batch_inverse", "MATRIX.BATCH.INVERSE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is k square n×n blocks stacked vertically.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the inverse of each stacked square block.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A_m^{-1}\] for every block m = 1, ..., k with partial pivoting.</p>
+<p><b>Input:</b> A(kn×n) holding blocks A_m(n×n)</p>
+<p><b>Output:</b> Stacked inverses (kn×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_batch_inverse(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+
+        _FP12* X = fp_alloc(A.rows(), A.cols());
+        batch_inverse(A, fp_out(X));
+
+        return X;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.BATCH.SOLVE - Solve each stacked system
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_batch_solve(
+    Function(XLL_FP, "xll_matrix_batch_solve", "MATRIX.BATCH.SOLVE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is k square n×n blocks stacked vertically."),
+        Arg(XLL_FP, "B", "is k right-hand side n×p blocks stacked vertically.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Solve A_m x_m = b_m for each pair of stacked blocks.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves \[A_m X_m = B_m\] for every block m = 1, ..., k with partial pivoting.</p>
+<p><b>Input:</b> A(kn×n) holding blocks A_m(n×n), B(kn×p) holding blocks B_m(n×p)</p>
+<p><b>Output:</b> Stacked solutions (kn×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_batch_solve(_FP12* pa, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+        auto B = fp_map(pb);
+
+        if (A.rows() != B.rows()) {
+            return nullptr;
+        }
+
+        _FP12* X = fp_alloc(B.rows(), B.cols());
+        batch_solve(A, B, fp_out(X));
+
+        return X;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.BATCH.DET - Determinant of each stacked block
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_batch_det(
+    Function(XLL_FP, "xll_matrix_batch_det", "MATRIX.BATCH.DET")
+    .Arguments({
+        Arg(XLL_FP, "A", "is k square n×n blocks stacked vertically.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the determinant of each stacked square block.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[\det(A_m)\] for every block m = 1, ..., k.</p>
+<p><b>Input:</b> A(kn×n) holding blocks A_m(n×n)</p>
+<p><b>Output:</b> Column vector of determinants (k×1)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_batch_det(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+
+        _FP12* d = fp_alloc(blocks(A), 1);
+        batch_determinant(A, Map<VectorXd>(d->array, d->rows));
+
+        return d;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.BATCH.CHOLESKY - Cholesky factor of each stacked block
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_batch_cholesky(
+    Function(XLL_FP, "xll_matrix_batch_cholesky", "MATRIX.BATCH.CHOLESKY")
+    .Arguments({
+        Arg(XLL_FP, "A", "is k symmetric positive-definite n×n blocks stacked vertically.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the Cholesky factor of each stacked SPD block.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes lower triangular \[L_m\] with \[A_m = L_m L_m^T\] for every block
+m = 1, ..., k. Only the lower triangle of each block is read. Blocks that are
+not positive definite return #NUM!.</p>
+<p><b>Input:</b> A(kn×n) holding blocks A_m(n×n)</p>
+<p><b>Output:</b> Stacked factors (kn×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_batch_cholesky(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+
+        _FP12* L = fp_alloc(A.rows(), A.cols());
+        batch_cholesky(A, fp_out(L));
+
+        return L;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
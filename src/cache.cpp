@@ -0,0 +1,400 @@
+// ==============================================================================
+// cache.cpp - Content-hash memoization of LINALG results
+// ==============================================================================
+
+#include <cstring>
+#include "cache.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XLL_HASH_SSE2
+#endif
+
+using namespace xll;
+
+// ==============================================================================
+// Hash
+// ==============================================================================
+// Stripes of four 64-bit lanes are accumulated with the 32×32→64 multiply
+// and lane swap used by XXH3, so the loop maps onto SSE2 _mm_mul_epu32.
+// The key advances by an odd step every stripe so the hash depends on where
+// each stripe is, not only on which stripes occur. The scalar fallback
+// computes the same value.
+
+namespace {
+
+    constexpr uint64_t hash_key[4] = {
+        0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL,
+        0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    };
+    // Added to hash_key after every stripe
+    constexpr uint64_t hash_step[4] = {
+        0x9e3779b97f4a7c15ULL, 0xd6e8feb86659fd93ULL,
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+    };
+
+    constexpr uint64_t mix(uint64_t x) noexcept
+    {
+        // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+
+        return x;
+    }
+
+    void accumulate_scalar(uint64_t acc[4], const uint64_t data[4], const uint64_t key[4]) noexcept
+    {
+        for (int i = 0; i < 4; ++i) {
+            const uint64_t dk = data[i] ^ key[i];
+            acc[i] += data[i ^ 1] + (dk & 0xFFFFFFFFULL) * (dk >> 32);
+        }
+    }
+
+#ifdef XLL_HASH_SSE2
+    inline __m128i accumulate_sse2(__m128i acc, __m128i data, __m128i key) noexcept
+    {
+        const __m128i dk = _mm_xor_si128(data, key);
+        const __m128i hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+        const __m128i product = _mm_mul_epu32(dk, hi);
+        const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+        return _mm_add_epi64(_mm_add_epi64(acc, swapped), product);
+    }
+#endif
+
+} // namespace
+
+uint64_t xll::fp_hash(uint64_t seed, const _FP12* fp)
+{
+    const size_t n = static_cast<size_t>(xll::size(*fp));
+    const size_t stripes = n / 4;
+    const double* p = fp->array;
+
+    uint64_t acc[4] = {
+        0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+        0x165667b19e3779f9ULL, 0x85ebca77c2b2ae63ULL,
+    };
+
+    uint64_t key[4] = { hash_key[0], hash_key[1], hash_key[2], hash_key[3] };
+
+#ifdef XLL_HASH_SSE2
+    __m128i acc0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+    __m128i acc1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2));
+    __m128i key0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+    __m128i key1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 2));
+    const __m128i step0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hash_step));
+    const __m128i step1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hash_step + 2));
+    for (size_t i = 0; i < stripes; ++i, p += 4) {
+        acc0 = accumulate_sse2(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), key0);
+        acc1 = accumulate_sse2(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2)), key1);
+        key0 = _mm_add_epi64(key0, step0);
+        key1 = _mm_add_epi64(key1, step1);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), acc0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2), acc1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(key), key0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(key + 2), key1);
+#else
+    for (size_t i = 0; i < stripes; ++i, p += 4) {
+        uint64_t data[4];
+        std::memcpy(data, p, sizeof(data));
+        accumulate_scalar(acc, data, key);
+        for (int j = 0; j < 4; ++j) {
+            key[j] += hash_step[j];
+        }
+    }
+#endif
+
+    // Zero padded tail
+    if (const size_t tail = n - 4 * stripes) {
+        uint64_t data[4] = { 0, 0, 0, 0 };
+        std::memcpy(data, p, tail * sizeof(double));
+        accumulate_scalar(acc, data, key);
+    }
+
+    uint64_t h = mix(seed ^ mix((static_cast<uint64_t>(fp->rows) << 32) | static_cast<uint32_t>(fp->columns)));
+    for (const uint64_t a : acc) {
+        h = mix(h ^ a);
+    }
+
+    return mix(h ^ n);
+}
+
+// ==============================================================================
+// LRU Cache
+// ==============================================================================
+
+result_cache::result_cache(size_t budget)
+    : limit(budget)
+{ }
+
+void result_cache::evict(size_t target)
+{
+    while (bytes > target && !lru.empty()) {
+        const entry& e = lru.back();
+        bytes -= (e.array.size() + e.inputs.size()) * sizeof(double);
+        index.erase(e.key);
+        lru.pop_back();
+    }
+}
+
+namespace {
+
+    // Append the dimensions and elements of fp
+    void append_input(std::vector<double>& inputs, const _FP12* fp)
+    {
+        inputs.push_back(fp->rows);
+        inputs.push_back(fp->columns);
+        inputs.insert(inputs.end(), fp->array, fp->array + xll::size(*fp));
+    }
+
+    // Compare fp with the copy starting at inputs[k] and advance k past it.
+    // Elements are compared bitwise so NaN arguments match themselves.
+    bool match_input(const std::vector<double>& inputs, size_t& k, const _FP12* fp)
+    {
+        const size_t n = static_cast<size_t>(xll::size(*fp));
+        if (k + 2 + n > inputs.size() || inputs[k] != fp->rows || inputs[k + 1] != fp->columns) {
+            return false;
+        }
+        k += 2;
+        if (n && std::memcmp(inputs.data() + k, fp->array, n * sizeof(double)) != 0) {
+            return false;
+        }
+        k += n;
+
+        return true;
+    }
+
+    bool same_inputs(const std::vector<double>& inputs, const _FP12* pa, const _FP12* pb)
+    {
+        size_t k = 0;
+
+        return match_input(inputs, k, pa) && (!pb || match_input(inputs, k, pb)) && k == inputs.size();
+    }
+
+} // namespace
+
+_FP12* result_cache::find(uint64_t key, const _FP12* pa, const _FP12* pb)
+{
+    std::lock_guard lock(mutex);
+
+    const auto i = index.find(key);
+    if (i == index.end() || !same_inputs(i->second->inputs, pa, pb)) {
+        ++misses;
+
+        return nullptr;
+    }
+    ++hits;
+
+    // Move to front
+    lru.splice(lru.begin(), lru, i->second);
+    const entry& e = *i->second;
+    _FP12* result = fp_alloc(e.rows, e.columns);
+    std::copy(e.array.begin(), e.array.end(), result->array);
+
+    return result;
+}
+
+bool result_cache::find(uint64_t key, const _FP12* pa, const _FP12* pb, double& value)
+{
+    std::lock_guard lock(mutex);
+
+    const auto i = index.find(key);
+    if (i == index.end() || !same_inputs(i->second->inputs, pa, pb)) {
+        ++misses;
+
+        return false;
+    }
+    ++hits;
+
+    lru.splice(lru.begin(), lru, i->second);
+    value = i->second->array[0];
+
+    return true;
+}
+
+void result_cache::insert(uint64_t key, const _FP12* pa, const _FP12* pb, const _FP12* result)
+{
+    if (!result) {
+        return;
+    }
+
+    const size_t n = static_cast<size_t>(xll::size(*result));
+    const size_t m = 2 + static_cast<size_t>(xll::size(*pa)) + (pb ? 2 + static_cast<size_t>(xll::size(*pb)) : 0);
+    const size_t size = (n + m) * sizeof(double);
+    std::lock_guard lock(mutex);
+
+    if (size > limit || index.contains(key)) {
+        return;
+    }
+
+    std::vector<double> inputs;
+    inputs.reserve(m);
+    append_input(inputs, pa);
+    if (pb) {
+        append_input(inputs, pb);
+    }
+
+    evict(limit - size);
+    lru.push_front(entry{ key, result->rows, result->columns,
+                          std::vector<double>(result->array, result->array + n), std::move(inputs) });
+    index[key] = lru.begin();
+    bytes += size;
+}
+
+void result_cache::insert(uint64_t key, const _FP12* pa, const _FP12* pb, double value)
+{
+    const fp12<1, 1> result{ .array = { value } };
+
+    insert(key, pa, pb, result.get());
+}
+
+size_t result_cache::budget(size_t new_limit)
+{
+    std::lock_guard lock(mutex);
+
+    const size_t old = limit;
+    limit = new_limit;
+    evict(limit);
+
+    return old;
+}
+
+void result_cache::clear()
+{
+    std::lock_guard lock(mutex);
+
+    evict(0);
+}
+
+result_cache::counters result_cache::stats(bool reset)
+{
+    std::lock_guard lock(mutex);
+
+    const counters c{ hits, misses, index.size(), bytes, limit };
+    if (reset) {
+        hits = 0;
+        misses = 0;
+    }
+
+    return c;
+}
+
+result_cache& xll::linalg_cache()
+{
+    static result_cache cache(256 << 20); // 256 MB
+
+    return cache;
+}
+
+// ==============================================================================
+// Cache Functions (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.CACHE.STATS - Cache hit/miss counters
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_cache_stats(
+    Function(XLL_FP, "xll_matrix_cache_stats", "MATRIX.CACHE.STATS")
+    .Arguments({
+        Arg(XLL_LPOPER, "reset", "is an optional boolean to reset the hit and miss counters after reading them.")
+    })
+    .ThreadSafe()
+    .Volatile()
+    .FunctionHelp("Return hits, misses, entries, bytes, and budget of the LINALG result cache.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Expensive LINALG functions (MATRIX.INVERSE, MATRIX.CHOLESKY, MATRIX.DETERMINANT,
+decompositions and solvers) look up their result by a hash of the function id
+and the dimensions and bytes of their arguments before computing it. A hit is
+only used if the arguments are identical to the stored copy; bytes include
+those copies.</p>
+<p><b>Output:</b> Row vector {hits, misses, entries, bytes, budget} (1×5)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_cache_stats(LPOPER preset)
+{
+#pragma XLLEXPORT
+    try {
+        const auto c = linalg_cache().stats(static_cast<bool>(*preset));
+        const double stats[5] = {
+            static_cast<double>(c.hits),
+            static_cast<double>(c.misses),
+            static_cast<double>(c.entries),
+            static_cast<double>(c.bytes),
+            static_cast<double>(c.budget)
+        };
+
+        return row_vector_to_fp(Eigen::Map<const Eigen::VectorXd>(stats, 5));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.CACHE.BUDGET - Set cache byte budget
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_cache_budget(
+    Function(XLL_DOUBLE, "xll_matrix_cache_budget", "MATRIX.CACHE.BUDGET")
+    .Arguments({
+        Arg(XLL_LPOPER, "bytes", "is the optional new byte budget. Use 0 to disable caching.")
+    })
+    .FunctionHelp("Set the LINALG result cache byte budget and return the old budget.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Least recently used results are evicted until the cache fits the budget.
+The default budget is 256 MB. Fractions of a byte are dropped, and budgets
+larger than the address space leave the cache unlimited.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+double WINAPI xll_matrix_cache_budget(LPOPER pbytes)
+{
+#pragma XLLEXPORT
+    try {
+        auto& cache = linalg_cache();
+
+        if (isNum(*pbytes) && Num(*pbytes) >= 0) {
+            // Whole bytes, and no more than size_t holds
+            const double bytes = std::floor(Num(*pbytes));
+            constexpr double most = static_cast<double>((std::numeric_limits<size_t>::max)());
+            const size_t budget = bytes < most ? static_cast<size_t>(bytes) : (std::numeric_limits<size_t>::max)();
+
+            return static_cast<double>(cache.budget(budget));
+        }
+
+        return static_cast<double>(cache.stats().budget);
+    }
+    catch (...) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.CACHE.CLEAR - Remove all cached results
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_cache_clear(
+    Macro("xll_matrix_cache_clear", "MATRIX.CACHE.CLEAR")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+int WINAPI xll_matrix_cache_clear(void)
+{
+#pragma XLLEXPORT
+    linalg_cache().clear();
+
+    return TRUE;
+}
@@ -0,0 +1,923 @@
+// ==============================================================================
+// dense.cpp - Dense matrix handles
+// ==============================================================================
+// \MATRIX.HANDLE wraps a range. \MATRIX.MUL, \MATRIX.INVERSE,
+// \MATRIX.PSEUDO_INV and \MATRIX.SVD_FULL return handles to their results
+// instead of arrays, and accept handles as well as ranges for their
+// arguments. \MATRIX.VIEW, \MATRIX.TRANSPOSE and \MATRIX.RESHAPE return views
+// that share storage with their parent. MATRIX.WINDOW and MATRIX.AT read back
+// part of a result, and MATRIX.HANDLE.WRITE modifies one copy-on-write.
+// \MATRIX.APPENDABLE and MATRIX.APPEND.ROWS grow a handle a row at a time.
+// ==============================================================================
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include "dense.h"
+#include "async.h"
+#include "mapped.h"
+
+using namespace xll;
+using namespace Eigen;
+
+dense_matrix::dense_matrix(RowMatrixXd A)
+    : storage_(std::make_shared<RowMatrixXd>(std::move(A))), offset_(0),
+      rows_(storage_->rows()), cols_(storage_->cols()), row_stride_(cols_), col_stride_(1)
+{ }
+
+dense_matrix::dense_matrix(Index cols, Index capacity, Index chunk, Index last)
+    : offset_(0), rows_(0), cols_(cols), row_stride_(cols), col_stride_(1),
+      appendable_(true), chunk_(chunk), last_(last)
+{
+    // Validate before allocating
+    ensure(cols > 0 && capacity >= 0 && chunk >= 0 && last >= 0);
+
+    storage_ = std::make_shared<RowMatrixXd>(last ? 2 * last : (std::max)(capacity, Index(1)), cols);
+}
+
+dense_matrix::dense_matrix(const dense_matrix& A)
+    : storage_(A.storage_), offset_(A.offset_), rows_(A.rows_), cols_(A.cols_),
+      row_stride_(A.row_stride_), col_stride_(A.col_stride_)
+{ }
+
+dense_matrix::dense_matrix(const dense_matrix& parent, Index row, Index col, Index rows, Index cols,
+    Index row_step, Index col_step)
+    : storage_(parent.storage_), offset_(parent.offset_ + row * parent.row_stride_ + col * parent.col_stride_),
+      rows_(rows), cols_(cols), row_stride_(row_step * parent.row_stride_), col_stride_(col_step * parent.col_stride_)
+{
+    ensure(row >= 0 && col >= 0 && rows > 0 && cols > 0 && row_step > 0 && col_step > 0);
+    ensure(row + (rows - 1) * row_step < parent.rows_ && col + (cols - 1) * col_step < parent.cols_);
+}
+
+dense_matrix dense_matrix::transpose() const
+{
+    dense_matrix t(*this);
+    std::swap(t.rows_, t.cols_);
+    std::swap(t.row_stride_, t.col_stride_);
+
+    return t;
+}
+
+dense_matrix dense_matrix::reshape(Index rows, Index cols) const
+{
+    ensure(rows > 0 && cols > 0 && rows * cols == rows_ * cols_);
+
+    if (col_stride_ != 1 || (rows_ > 1 && row_stride_ != cols_)) {
+        const RowMatrixXd A = view();
+        return dense_matrix(A).reshape(rows, cols);
+    }
+
+    dense_matrix r(*this);
+    r.rows_ = rows;
+    r.cols_ = cols;
+    r.row_stride_ = cols;
+
+    return r;
+}
+
+dense_view_mut dense_matrix::modify()
+{
+    // Each row of a ring buffer is stored twice
+    ensure(!last_);
+
+    if (storage_.use_count() > 1) {
+        auto copy = std::make_shared<RowMatrixXd>(view());
+        storage_ = std::move(copy);
+        offset_ = 0;
+        row_stride_ = cols_;
+        col_stride_ = 1;
+    }
+
+    return dense_view_mut(storage_->data() + offset_, rows_, cols_, Stride<Dynamic, Dynamic>(row_stride_, col_stride_));
+}
+
+void dense_matrix::append(const Eigen::Ref<const RowMatrixXd>& X)
+{
+    ensure(appendable_ && X.cols() == cols_);
+
+    if (last_) {
+        // Slots are overwritten, so views of the current rows need their own copy
+        if (storage_.use_count() > 1) {
+            storage_ = std::make_shared<RowMatrixXd>(*storage_);
+        }
+
+        // Rows that would be overwritten by this call are never written
+        const Index skip = (std::max)(X.rows() - last_, Index(0));
+        appended_ += skip;
+        for (Index i = skip; i < X.rows(); ++i, ++appended_) {
+            const Index slot = appended_ % last_;
+            storage_->row(slot) = X.row(i);
+            storage_->row(slot + last_) = X.row(i);
+        }
+        rows_ = (std::min)(appended_, last_);
+        offset_ = (appended_ > last_ ? appended_ % last_ : 0) * cols_;
+
+        return;
+    }
+
+    const Index rows = rows_ + X.rows();
+    if (rows > storage_->rows()) {
+        const Index capacity = chunk_
+            ? (rows + chunk_ - 1) / chunk_ * chunk_
+            : (std::max)(rows, 2 * storage_->rows());
+        auto grown = std::make_shared<RowMatrixXd>(capacity, cols_);
+        grown->topRows(rows_) = storage_->topRows(rows_);
+        storage_ = std::move(grown);
+    }
+    // Rows past rows_ are not visible to any view of the storage
+    storage_->middleRows(rows_, X.rows()) = X;
+    rows_ = rows;
+    appended_ += X.rows();
+}
+
+dense_view xll::dense_map(const _FP12* pa)
+{
+    if (xll::size(*pa) == 1 && is_handle(pa->array[0])) {
+        if (handle<dense_matrix> h(pa->array[0]); h) {
+            return h->view();
+        }
+    }
+
+    return dense_view(pa->array, pa->rows, pa->columns, Stride<Dynamic, Dynamic>(pa->columns, 1));
+}
+
+namespace {
+
+    // Copy sharing the storage of the handle held in a 1×1 argument, or nothing
+    // for a range. The lookup erases a temporary handle when it goes out of
+    // scope, so a pointer to it would dangle.
+    std::optional<dense_matrix> dense_handle(const _FP12* pa)
+    {
+        if (xll::size(*pa) == 1 && is_handle(pa->array[0])) {
+            if (handle<dense_matrix> h(pa->array[0]); h) {
+                return dense_matrix(*h);
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // Same layout as MATRIX.SVD_FULL: U, Σ and V^T stacked and zero padded
+    template<class SVD>
+    RowMatrixXd svd_stack(const SVD& svd, Index m, Index n)
+    {
+        const Index k = svd.singularValues().size();
+        RowMatrixXd R = RowMatrixXd::Zero(m + 2 * k, (std::max)({m, n, k}));
+        R.block(0, 0, m, k) = svd.matrixU();
+        R.block(m, 0, k, k).diagonal() = svd.singularValues();
+        R.block(m + k, 0, k, n) = svd.matrixV().transpose();
+
+        return R;
+    }
+
+    template<class SVD>
+    RowMatrixXd svd_pinv(const SVD& svd, Index m, Index n)
+    {
+        const VectorXd& s = svd.singularValues();
+        const double tolerance = std::numeric_limits<double>::epsilon() * (std::max)(m, n) * (s.size() ? s.maxCoeff() : 0);
+        const VectorXd sinv = (s.array() > tolerance).select(s.array().inverse(), 0.0).matrix();
+
+        return svd.matrixV() * sinv.asDiagonal() * svd.matrixU().transpose();
+    }
+
+} // namespace
+
+// ==============================================================================
+// Dense Handle Constructors (6 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.HANDLE - Dense matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_handle(
+    Function(XLL_HANDLEX, "xll_matrix_handle", "\\MATRIX.HANDLE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a copy of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies A once so later \MATRIX.* functions and MATRIX.WINDOW can use it
+without Excel passing the range again. If A is already a handle the new
+handle shares its storage until one of them is modified.</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p><b>Output:</b> Handle to the matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_handle(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const auto p = dense_handle(pa);
+        handle<dense_matrix> h(p ? new dense_matrix(*p) : new dense_matrix(fp_map(pa)));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.MUL - Matrix product handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_mul_handle(
+    Function(XLL_HANDLEX, "xll_matrix_mul_handle", "\\MATRIX.MUL")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function."),
+        Arg(XLL_FP, "B", "is a matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the product of A and B.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[C = AB\] like MATRIX.MUL but keeps C in a handle.</p>
+<p><b>Input:</b> A(m×n) and B(n×p)</p>
+<p><b>Output:</b> Handle to C(m×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_mul_handle(_FP12* pa, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        const auto A = dense_map(pa);
+        const auto B = dense_map(pb);
+        ensure(A.cols() == B.rows());
+
+        RowMatrixXd C(A.rows(), B.cols());
+        if (A.rows() * A.cols() * B.cols() < linalg_thresholds().gemm_parallel) {
+            C.noalias() = A * B;
+        }
+        else {
+            parallel_for(A.rows(), 16, [&](Index i, Index j) {
+                C.middleRows(i, j - i).noalias() = A.middleRows(i, j - i) * B;
+            });
+        }
+
+        handle<dense_matrix> h(new dense_matrix(std::move(C)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.INVERSE - Matrix inverse handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_inv_handle(
+    Function(XLL_HANDLEX, "xll_matrix_inv_handle", "\\MATRIX.INVERSE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square invertible matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the inverse of a square matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A^{-1}\] like MATRIX.INVERSE but keeps it in a handle. Use
+MATRIX.WINDOW to display only the rows the sheet needs.</p>
+<p><b>Input:</b> Invertible square matrix A(n×n)</p>
+<p><b>Output:</b> Handle to A^-1(n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_inv_handle(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const auto A = dense_map(pa);
+        ensure(A.rows() == A.cols());
+
+        handle<dense_matrix> h(new dense_matrix(PartialPivLU<RowMatrixXd>(A).inverse()));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.PSEUDO_INV - Pseudoinverse handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_pinv_handle(
+    Function(XLL_HANDLEX, "xll_matrix_pinv_handle", "\\MATRIX.PSEUDO_INV")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the Moore-Penrose pseudoinverse of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A^+ = V\Sigma^+U^T\] like MATRIX.PSEUDO_INV but keeps it in a
+handle.</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p><b>Output:</b> Handle to A^+(n×m)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_pinv_handle(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const MatrixXd A = dense_map(pa);
+        const Index m = A.rows();
+        const Index n = A.cols();
+
+        RowMatrixXd P;
+        if ((std::min)(m, n) >= linalg_thresholds().svd_divide_conquer) {
+            P = svd_pinv(BDCSVD<MatrixXd, ComputeThinU | ComputeThinV>(A), m, n);
+        }
+        else {
+            P = svd_pinv(JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV>(A), m, n);
+        }
+
+        handle<dense_matrix> h(new dense_matrix(std::move(P)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SVD_FULL - Stacked SVD handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_svd_full_handle(
+    Function(XLL_HANDLEX, "xll_matrix_svd_full_handle", "\\MATRIX.SVD_FULL")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to U, Σ and V^T stacked vertically.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A = U\Sigma V^T\] and keeps the same stacked layout as
+MATRIX.SVD_FULL in a handle: U in rows 1 to m, Σ in the next k rows and
+V^T in the last k rows, where k = min(m, n). Read a factor with
+MATRIX.WINDOW instead of returning the zero-padded (m+2k)×max(m,n) array.</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p><b>Output:</b> Handle to the stacked matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_svd_full_handle(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const MatrixXd A = dense_map(pa);
+        const Index m = A.rows();
+        const Index n = A.cols();
+
+        RowMatrixXd S;
+        if ((std::min)(m, n) >= linalg_thresholds().svd_divide_conquer) {
+            S = svd_stack(BDCSVD<MatrixXd, ComputeThinU | ComputeThinV>(A), m, n);
+        }
+        else {
+            S = svd_stack(JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV>(A), m, n);
+        }
+
+        handle<dense_matrix> h(new dense_matrix(std::move(S)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SCALE - Scalar multiple handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_scale_handle(
+    Function(XLL_HANDLEX, "xll_matrix_scale_handle", "\\MATRIX.SCALE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function."),
+        Arg(XLL_DOUBLE, "a", "is the scalar.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a times A.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[aA\]. When a = 1 and A is a handle no elements are touched and
+the result shares the storage of A.</p>
+<p><b>Input:</b> A(m×n)</p>
+<p><b>Output:</b> Handle to aA(m×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_scale_handle(_FP12* pa, double a)
+{
+#pragma XLLEXPORT
+    try {
+        const auto p = dense_handle(pa);
+        if (p && a == 1) {
+            handle<dense_matrix> h(new dense_matrix(*p));
+            return h.get();
+        }
+
+        handle<dense_matrix> h(new dense_matrix(a * dense_map(pa)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// ==============================================================================
+// Dense Handle Views (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.VIEW - Strided slice of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_view(
+    Function(XLL_HANDLEX, "xll_matrix_view", "\\MATRIX.VIEW")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function."),
+        Arg(XLL_DOUBLE, "row", "is the optional 1-based first row. Default is 1."),
+        Arg(XLL_DOUBLE, "col", "is the optional 1-based first column. Default is 1."),
+        Arg(XLL_DOUBLE, "rows", "is the optional number of rows. Default is as many as fit."),
+        Arg(XLL_DOUBLE, "cols", "is the optional number of columns. Default is as many as fit."),
+        Arg(XLL_DOUBLE, "rowstep", "is the optional step between rows. Default is 1."),
+        Arg(XLL_DOUBLE, "colstep", "is the optional step between columns. Default is 1.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a slice of a matrix handle without copying it.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns a handle that refers to rows row, row + rowstep, ... and columns
+col, col + colstep, ... of the parent. No data is copied: the view holds a
+reference to the parent's storage, which stays alive as long as any view of
+it does, even if the parent cell recalculates.</p>
+<p>Views are accepted wherever a \MATRIX function, MATRIX.SOLVE.ITER or
+MATRIX.OPERATOR.APPLY accepts a handle, and are read as strided arrays.</p>
+<p><b>Output:</b> Handle to the view (rows×cols)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_view(HANDLEX _h, double row, double col, double rows, double cols, double rowstep, double colstep)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> p(_h);
+        ensure(p);
+
+        const Index i = first_index(row);
+        const Index j = first_index(col);
+        const Index di = rowstep ? to_index(rowstep) : 1;
+        const Index dj = colstep ? to_index(colstep) : 1;
+        ensure(di > 0 && dj > 0 && i < p->rows() && j < p->cols());
+        const Index m = rows ? to_index(rows) : (p->rows() - i + di - 1) / di;
+        const Index n = cols ? to_index(cols) : (p->cols() - j + dj - 1) / dj;
+
+        handle<dense_matrix> h(new dense_matrix(*p, i, j, m, n, di, dj));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.TRANSPOSE - Transposed view of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_transpose_handle(
+    Function(XLL_HANDLEX, "xll_matrix_transpose_handle", "\\MATRIX.TRANSPOSE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the transpose of a matrix without copying it.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Swaps the row and column strides of a handle, so \[A^T\] costs O(1) and
+shares storage with A. A range is copied once in its own layout and viewed
+transposed.</p>
+<p><b>Input:</b> A(m×n)</p>
+<p><b>Output:</b> Handle to A^T(n×m)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_transpose_handle(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const auto p = dense_handle(pa);
+        handle<dense_matrix> h(new dense_matrix(p ? p->transpose() : dense_matrix(fp_map(pa)).transpose()));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.RESHAPE - Reshaped view of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_reshape_handle(
+    Function(XLL_HANDLEX, "xll_matrix_reshape_handle", "\\MATRIX.RESHAPE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix or a handle returned by a \\MATRIX function."),
+        Arg(XLL_DOUBLE, "rows", "is the number of rows of the result."),
+        Arg(XLL_DOUBLE, "cols", "is the number of columns of the result.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the elements of A read row by row into rows×cols.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Reads A in row-major order into a rows×cols matrix. A handle whose elements
+are contiguous, such as any result or a view of whole rows, is reshaped
+without copying. Strided views are copied once.</p>
+<p><b>Input:</b> A(m×n) with mn = rows·cols</p>
+<p><b>Output:</b> Handle to the reshaped matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_reshape_handle(_FP12* pa, double rows, double cols)
+{
+#pragma XLLEXPORT
+    try {
+        const Index m = to_index(rows);
+        const Index n = to_index(cols);
+        const auto p = dense_handle(pa);
+        handle<dense_matrix> h(new dense_matrix(p ? p->reshape(m, n) : dense_matrix(fp_map(pa)).reshape(m, n)));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// ==============================================================================
+// Dense Handle Accessors (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.WINDOW - Copy part of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_window(
+    Function(XLL_FP, "xll_matrix_window", "MATRIX.WINDOW")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function."),
+        Arg(XLL_DOUBLE, "row", "is the optional 1-based first row. Default is 1."),
+        Arg(XLL_DOUBLE, "col", "is the optional 1-based first column. Default is 1."),
+        Arg(XLL_DOUBLE, "rows", "is the optional number of rows. Default is the rest of the matrix."),
+        Arg(XLL_DOUBLE, "cols", "is the optional number of columns. Default is the rest of the matrix.")
+    })
+    .FunctionHelp("Return a window of a matrix handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies only the requested rows×cols window into the result, so a sheet that
+shows a few rows of a large result marshals only those cells. Works on
+memory-mapped handles from \MATRIX.MAP.CREATE as well.</p>
+<p><b>Output:</b> The window (rows×cols)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_window(HANDLEX _h, double row, double col, double rows, double cols)
+{
+#pragma XLLEXPORT
+    try {
+        const Index i = first_index(row);
+        const Index j = first_index(col);
+
+        if (handle<dense_matrix> h(_h); h) {
+            const Index m = rows ? to_index(rows) : h->rows() - i;
+            const Index n = cols ? to_index(cols) : h->cols() - j;
+            ensure(m > 0 && n > 0 && i + m <= h->rows() && j + n <= h->cols());
+
+            return eigen_to_fp(h->view().block(i, j, m, n));
+        }
+        if (handle<tiled_matrix> t(_h); t) {
+            const Index m = rows ? to_index(rows) : t->rows() - i;
+            const Index n = cols ? to_index(cols) : t->cols() - j;
+            ensure(m > 0 && n > 0);
+
+            _FP12* result = fp_alloc(m, n);
+            auto window = fp_out(result);
+            t->read(i, j, window);
+
+            return result;
+        }
+
+        return nullptr;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.AT - One element of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_at(
+    Function(XLL_DOUBLE, "xll_matrix_at", "MATRIX.AT")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function."),
+        Arg(XLL_DOUBLE, "i", "is the 1-based row."),
+        Arg(XLL_DOUBLE, "j", "is the 1-based column.")
+    })
+    .FunctionHelp("Return one element of a matrix handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns \[a_{ij}\] without allocating an array. Works on memory-mapped
+handles from \MATRIX.MAP.CREATE as well.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+double WINAPI xll_matrix_at(HANDLEX _h, double i, double j)
+{
+#pragma XLLEXPORT
+    try {
+        const Index i_ = to_index(i) - 1;
+        const Index j_ = to_index(j) - 1;
+        ensure(i_ >= 0 && j_ >= 0);
+
+        if (handle<dense_matrix> h(_h); h) {
+            ensure(i_ < h->rows() && j_ < h->cols());
+
+            return h->view()(i_, j_);
+        }
+        if (handle<tiled_matrix> t(_h); t) {
+            ensure(i_ < t->rows() && j_ < t->cols());
+
+            return t->block(i_ / t->tile(), j_ / t->tile())(i_ % t->tile(), j_ % t->tile());
+        }
+
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    catch (...) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.HANDLE.SIZE - Dimensions of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_handle_size(
+    Function(XLL_FP, "xll_matrix_handle_size", "MATRIX.HANDLE.SIZE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function.")
+    })
+    .FunctionHelp("Return the rows and columns of a matrix handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p><b>Output:</b> Row vector {rows, cols} (1×2)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_handle_size(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        const double size[2] = {
+            static_cast<double>(h->rows()),
+            static_cast<double>(h->cols())
+        };
+
+        return row_vector_to_fp(Map<const VectorXd>(size, 2));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// ==============================================================================
+// Copy-on-Write (2 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.HANDLE.WRITE - Overwrite part of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_handle_write(
+    Function(XLL_HANDLEX, "xll_matrix_handle_write", "MATRIX.HANDLE.WRITE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function."),
+        Arg(XLL_FP, "A", "is the block of values to write."),
+        Arg(XLL_DOUBLE, "row", "is the optional 1-based row of the top left cell. Default is 1."),
+        Arg(XLL_DOUBLE, "col", "is the optional 1-based column of the top left cell. Default is 1.")
+    })
+    .FunctionHelp("Write a range into a matrix handle and return the handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies A into the handle at (row, col). If other handles share its storage,
+such as views or reshapes, the handle first takes a private copy so they are
+unchanged. Otherwise the storage is written in place. Ring buffers from
+\MATRIX.APPENDABLE cannot be written.</p>
+<p>The handle is modified each time the cell calculates. Pass the result to
+the next function so Excel orders them.</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_handle_write(HANDLEX _h, _FP12* pa, double row, double col)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> h(_h);
+        ensure(h);
+
+        const auto A = fp_map(pa);
+        const Index i = first_index(row);
+        const Index j = first_index(col);
+        ensure(i + A.rows() <= h->rows() && j + A.cols() <= h->cols());
+
+        h->modify().block(i, j, A.rows(), A.cols()) = A;
+
+        return _h;
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.HANDLE.BYTES - Shared and unique storage of a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_handle_bytes(
+    Function(XLL_FP, "xll_matrix_handle_bytes", "MATRIX.HANDLE.BYTES")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX function.")
+    })
+    .FunctionHelp("Return the shared and unique storage bytes of a matrix handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p><b>shared</b>: bytes of storage also referred to by other handles</p>
+<p><b>unique</b>: bytes of storage only this handle refers to</p>
+<p><b>owners</b>: handles sharing the storage, including this one</p>
+<p>A view of a deleted parent is the unique owner of the whole parent
+storage, not only the elements it shows.</p>
+<p><b>Output:</b> Row vector {shared, unique, owners} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_handle_bytes(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        const double owners = static_cast<double>(h->owners());
+        const double bytes = static_cast<double>(h->bytes());
+        const double report[3] = {
+            owners > 1 ? bytes : 0,
+            owners > 1 ? 0 : bytes,
+            owners
+        };
+
+        return row_vector_to_fp(Map<const VectorXd>(report, 3));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// ==============================================================================
+// Appendable Handles (2 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.APPENDABLE - Growable matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_appendable(
+    Function(XLL_HANDLEX, "xll_matrix_appendable", "\\MATRIX.APPENDABLE")
+    .Arguments({
+        Arg(XLL_DOUBLE, "cols", "is the number of columns."),
+        Arg(XLL_DOUBLE, "capacity", "is the optional number of rows to reserve. Default is 64."),
+        Arg(XLL_DOUBLE, "chunk", "is the optional number of rows to add when full. Default is 0 to double the capacity."),
+        Arg(XLL_DOUBLE, "last", "is the optional number of latest rows to keep. Default is 0 for all rows.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to an empty matrix that rows can be appended to.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Creates a matrix with no rows for MATRIX.APPEND.ROWS. When the reserved
+rows run out the storage doubles, or grows by chunk rows if chunk is given, so
+appending one row at a time costs O(1) amortized instead of copying the whole
+matrix.</p>
+<p>With last > 0 the handle is a ring buffer of the latest last rows. Older
+rows are overwritten in place and the storage never grows.</p>
+<p>The handle is read without a copy by every function that accepts a matrix
+handle, and MATRIX.WINDOW shows the latest rows.</p>
+<p><b>Output:</b> Handle to the matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_appendable(double cols, double capacity, double chunk, double last)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> h(new dense_matrix(to_index(cols), capacity ? to_index(capacity) : 64, to_index(chunk), to_index(last)));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.APPEND.ROWS - Append rows to a matrix handle
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_append_rows(
+    Function(XLL_HANDLEX, "xll_matrix_append_rows", "MATRIX.APPEND.ROWS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.APPENDABLE."),
+        Arg(XLL_FP, "X", "is one or more rows to append.")
+    })
+    .FunctionHelp("Append rows to a matrix handle and return the handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies the k rows of X below the existing rows in O(k) amortized. Rows are
+written past the end of every view of the handle, so views and copies made
+earlier keep their values without being copied. A ring buffer with live views
+copies its storage once before overwriting old rows.</p>
+<p>Each cell appends its rows once. Recalculating the cell with the same
+handle and X leaves the handle unchanged, and changing X appends the new
+rows. Pass the result to the next function so Excel orders them.</p>
+<p><b>Input:</b> Handle, X(k×n)</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_append_rows(HANDLEX _h, _FP12* px)
+{
+#pragma XLLEXPORT
+    try {
+        handle<dense_matrix> h(_h);
+        ensure(h && h->appendable());
+
+        std::vector<double> inputs{ static_cast<double>(px->rows), static_cast<double>(px->columns) };
+        inputs.insert(inputs.end(), px->array, px->array + xll::size(*px));
+        const OPER caller = Excel(xlfCaller);
+        if (!h->applied.repeated(caller, inputs)) {
+            h->append(fp_map(px));
+            h->applied.record(caller, std::move(inputs));
+        }
+
+        return _h;
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
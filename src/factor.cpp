@@ -0,0 +1,1418 @@
+// ==============================================================================
+// factor.cpp - Matrix factorization handles
+// ==============================================================================
+// Uncalced constructors \MATRIX.LU, \MATRIX.CHOL, \MATRIX.QR, \MATRIX.SVD and
+// \MATRIX.EIG return handles to factorizations. MATRIX.FACTOR.* functions
+// reuse a factorization without recomputing it.
+// ==============================================================================
+
+#include <cmath>
+#include <vector>
+#include "factor.h"
+
+using namespace xll;
+using namespace Eigen;
+
+// ==============================================================================
+// Factorization Implementations
+// ==============================================================================
+
+// Arguments are narrowed to T on the way in and results widened on the way out.
+// For T = double the casts are no-ops.
+
+// -----------------------------------------------------------------------------
+// LU
+// -----------------------------------------------------------------------------
+
+template<class T>
+basic_lu_factor<T>::basic_lu_factor(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    ensure(A.rows() == A.cols());
+
+    lu.compute(A.cast<T>());
+}
+
+template<class T>
+Index basic_lu_factor<T>::rows() const
+{
+    return lu.rows();
+}
+
+template<class T>
+Index basic_lu_factor<T>::cols() const
+{
+    return lu.cols();
+}
+
+template<class T>
+MatrixXd basic_lu_factor<T>::solve(const MatrixXd& b) const
+{
+    return lu.solve(b.cast<T>()).template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_lu_factor<T>::U() const
+{
+    MatrixXd L = MatrixXd::Identity(lu.rows(), lu.cols());
+    L.triangularView<StrictlyLower>() = lu.matrixLU().template cast<double>();
+
+    return L;
+}
+
+template<class T>
+MatrixXd basic_lu_factor<T>::V() const
+{
+    return lu.matrixLU().template cast<double>().template triangularView<Upper>();
+}
+
+template<class T>
+VectorXd basic_lu_factor<T>::values() const
+{
+    return lu.matrixLU().diagonal().template cast<double>();
+}
+
+template<class T>
+double basic_lu_factor<T>::logdet() const
+{
+    return lu.matrixLU().diagonal().template cast<double>().array().abs().log().sum();
+}
+
+// -----------------------------------------------------------------------------
+// Cholesky
+// -----------------------------------------------------------------------------
+
+template<class T>
+basic_chol_factor<T>::basic_chol_factor(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    ensure(A.rows() == A.cols());
+
+    llt.compute(A.cast<T>());
+    ensure(llt.info() == Success); // positive definite
+}
+
+template<class T>
+Index basic_chol_factor<T>::rows() const
+{
+    return llt.rows();
+}
+
+template<class T>
+Index basic_chol_factor<T>::cols() const
+{
+    return llt.cols();
+}
+
+template<class T>
+MatrixXd basic_chol_factor<T>::solve(const MatrixXd& b) const
+{
+    return llt.solve(b.cast<T>()).template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_chol_factor<T>::U() const
+{
+    return llt.matrixLLT().template cast<double>().template triangularView<Lower>();
+}
+
+template<class T>
+MatrixXd basic_chol_factor<T>::V() const
+{
+    return llt.matrixLLT().template cast<double>().transpose().template triangularView<Upper>();
+}
+
+template<class T>
+VectorXd basic_chol_factor<T>::values() const
+{
+    return llt.matrixLLT().diagonal().template cast<double>();
+}
+
+template<class T>
+double basic_chol_factor<T>::logdet() const
+{
+    return 2 * llt.matrixLLT().diagonal().template cast<double>().array().log().sum();
+}
+
+// -----------------------------------------------------------------------------
+// QR
+// -----------------------------------------------------------------------------
+
+template<class T>
+basic_qr_factor<T>::basic_qr_factor(const Eigen::Ref<const RowMatrixXd>& A)
+    : qr(A.cast<T>())
+{ }
+
+template<class T>
+Index basic_qr_factor<T>::rows() const
+{
+    return qr.rows();
+}
+
+template<class T>
+Index basic_qr_factor<T>::cols() const
+{
+    return qr.cols();
+}
+
+template<class T>
+MatrixXd basic_qr_factor<T>::solve(const MatrixXd& b) const
+{
+    return qr.solve(b.cast<T>()).template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_qr_factor<T>::U() const
+{
+    // Thin Q (m×k)
+    const Index k = (std::min)(qr.rows(), qr.cols());
+    const matrix Q = qr.householderQ() * matrix::Identity(qr.rows(), k);
+
+    return Q.template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_qr_factor<T>::V() const
+{
+    // R (k×n)
+    const Index k = (std::min)(qr.rows(), qr.cols());
+
+    return qr.matrixQR().topRows(k).template cast<double>().template triangularView<Upper>();
+}
+
+template<class T>
+VectorXd basic_qr_factor<T>::values() const
+{
+    return qr.matrixQR().diagonal().template cast<double>();
+}
+
+template<class T>
+double basic_qr_factor<T>::logdet() const
+{
+    return qr.matrixQR().diagonal().template cast<double>().array().abs().log().sum();
+}
+
+// -----------------------------------------------------------------------------
+// SVD
+// -----------------------------------------------------------------------------
+
+template<class T>
+basic_svd_factor<T>::basic_svd_factor(const Eigen::Ref<const RowMatrixXd>& A)
+    : svd(A.cast<T>())
+{ }
+
+template<class T>
+Index basic_svd_factor<T>::rows() const
+{
+    return svd.rows();
+}
+
+template<class T>
+Index basic_svd_factor<T>::cols() const
+{
+    return svd.cols();
+}
+
+template<class T>
+MatrixXd basic_svd_factor<T>::solve(const MatrixXd& b) const
+{
+    return svd.solve(b.cast<T>()).template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_svd_factor<T>::U() const
+{
+    return svd.matrixU().template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_svd_factor<T>::V() const
+{
+    return svd.matrixV().template cast<double>();
+}
+
+template<class T>
+VectorXd basic_svd_factor<T>::values() const
+{
+    return svd.singularValues().template cast<double>();
+}
+
+template<class T>
+double basic_svd_factor<T>::logdet() const
+{
+    return svd.singularValues().template cast<double>().array().log().sum();
+}
+
+// -----------------------------------------------------------------------------
+// Eigendecomposition
+// -----------------------------------------------------------------------------
+
+template<class T>
+basic_eig_factor<T>::basic_eig_factor(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    ensure(A.rows() == A.cols());
+
+    es.compute(A.cast<T>());
+    ensure(es.info() == Success);
+
+    lu.compute(es.eigenvectors());
+}
+
+template<class T>
+Index basic_eig_factor<T>::rows() const
+{
+    return es.eigenvectors().rows();
+}
+
+template<class T>
+Index basic_eig_factor<T>::cols() const
+{
+    return es.eigenvectors().cols();
+}
+
+template<class T>
+MatrixXd basic_eig_factor<T>::solve(const MatrixXd& b) const
+{
+    // x = X Λ^-1 X^-1 b
+    using cmatrix = Matrix<std::complex<T>, Dynamic, Dynamic>;
+    const cmatrix y = lu.solve(b.cast<std::complex<T>>());
+    const cmatrix x = es.eigenvectors() * es.eigenvalues().cwiseInverse().asDiagonal() * y;
+
+    return x.real().template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_eig_factor<T>::U() const
+{
+    return es.eigenvectors().real().template cast<double>();
+}
+
+template<class T>
+MatrixXd basic_eig_factor<T>::V() const
+{
+    return MatrixXd();
+}
+
+template<class T>
+VectorXd basic_eig_factor<T>::values() const
+{
+    return es.eigenvalues().real().template cast<double>();
+}
+
+template<class T>
+double basic_eig_factor<T>::logdet() const
+{
+    return es.eigenvalues().array().abs().template cast<double>().log().sum();
+}
+
+template class xll::basic_lu_factor<double>;
+template class xll::basic_lu_factor<float>;
+template class xll::basic_chol_factor<double>;
+template class xll::basic_chol_factor<float>;
+template class xll::basic_qr_factor<double>;
+template class xll::basic_qr_factor<float>;
+template class xll::basic_svd_factor<double>;
+template class xll::basic_svd_factor<float>;
+template class xll::basic_eig_factor<double>;
+template class xll::basic_eig_factor<float>;
+
+// -----------------------------------------------------------------------------
+// Updatable Cholesky and QR
+// -----------------------------------------------------------------------------
+
+namespace {
+
+    // A downdate with 1 - ||R^-T x||² below this would lose about half the
+    // digits of R, so it refactors instead
+    constexpr double downdate_tol = 1e-8;
+
+    // Rotation with [c s; -s c] [a; b] = [r; 0] and r ≥ 0
+    void givens(double a, double b, double& c, double& s, double& r)
+    {
+        r = std::hypot(a, b);
+        if (r == 0) {
+            c = 1;
+            s = 0;
+        }
+        else {
+            c = a / r;
+            s = b / r;
+        }
+    }
+
+    // R with column j deleted, retriangularized by rotating adjacent rows
+    void r_delete_column(RowMatrixXd& R, Index j)
+    {
+        const Index n = R.cols();
+        RowMatrixXd H(n, n - 1);
+        H.leftCols(j) = R.leftCols(j);
+        H.rightCols(n - j - 1) = R.rightCols(n - j - 1);
+        for (Index k = j; k < n - 1; ++k) {
+            double c, s, r;
+            givens(H(k, k), H(k + 1, k), c, s, r);
+            H(k, k) = r;
+            H(k + 1, k) = 0;
+            for (Index q = k + 1; q < n - 1; ++q) {
+                const double t = c * H(k, q) + s * H(k + 1, q);
+                H(k + 1, q) = c * H(k + 1, q) - s * H(k, q);
+                H(k, q) = t;
+            }
+        }
+
+        R = H.topRows(n - 1);
+    }
+
+    // Indices 0, ..., n - 1 except j
+    std::vector<Index> all_but(Index n, Index j)
+    {
+        std::vector<Index> keep;
+        for (Index i = 0; i < n; ++i) {
+            if (i != j) {
+                keep.push_back(i);
+            }
+        }
+
+        return keep;
+    }
+
+} // namespace
+
+void xll::triangular_update(RowMatrixXd& R, Eigen::RowVectorXd x)
+{
+    const Index n = R.cols();
+    for (Index k = 0; k < n; ++k) {
+        double c, s, r;
+        givens(R(k, k), x(k), c, s, r);
+        R(k, k) = r;
+        for (Index j = k + 1; j < n; ++j) {
+            const double t = c * R(k, j) + s * x(j);
+            x(j) = c * x(j) - s * R(k, j);
+            R(k, j) = t;
+        }
+    }
+}
+
+bool xll::triangular_downdate(RowMatrixXd& R, const Eigen::RowVectorXd& x)
+{
+    const Index n = R.cols();
+    const VectorXd p = R.triangularView<Upper>().transpose().solve(x.transpose());
+    const double alpha2 = 1 - p.squaredNorm();
+    if (!(alpha2 > downdate_tol)) {
+        return false;
+    }
+
+    VectorXd c(n), s(n);
+    double alpha = std::sqrt(alpha2);
+    for (Index i = n - 1; i >= 0; --i) {
+        const double scale = alpha + std::abs(p(i));
+        const double a = alpha / scale;
+        const double b = p(i) / scale;
+        const double norm = std::sqrt(a * a + b * b);
+        c(i) = a / norm;
+        s(i) = b / norm;
+        alpha = scale * norm;
+    }
+    for (Index j = 0; j < n; ++j) {
+        double xx = 0;
+        for (Index i = j; i >= 0; --i) {
+            const double t = c(i) * xx + s(i) * R(i, j);
+            R(i, j) = c(i) * R(i, j) - s(i) * xx;
+            xx = t;
+        }
+    }
+
+    // Keep the diagonal positive
+    for (Index i = 0; i < n; ++i) {
+        if (R(i, i) < 0) {
+            R.row(i) = -R.row(i);
+        }
+    }
+
+    return true;
+}
+
+chol_update_factor::chol_update_factor(const Eigen::Ref<const RowMatrixXd>& A_)
+{
+    ensure(A_.rows() == A_.cols());
+
+    refactor(A_);
+}
+
+void chol_update_factor::refactor(Eigen::MatrixXd A1)
+{
+    LLT<MatrixXd> llt(A1);
+    ensure(llt.info() == Success); // positive definite
+
+    R = llt.matrixU();
+    A = std::move(A1);
+}
+
+Index chol_update_factor::rows() const
+{
+    return R.rows();
+}
+
+Index chol_update_factor::cols() const
+{
+    return R.cols();
+}
+
+MatrixXd chol_update_factor::solve(const MatrixXd& b) const
+{
+    const auto U = R.triangularView<Upper>();
+
+    return U.solve(U.transpose().solve(b));
+}
+
+MatrixXd chol_update_factor::U() const
+{
+    return R.transpose();
+}
+
+MatrixXd chol_update_factor::V() const
+{
+    return R;
+}
+
+VectorXd chol_update_factor::values() const
+{
+    return R.diagonal();
+}
+
+double chol_update_factor::logdet() const
+{
+    return 2 * R.diagonal().array().log().sum();
+}
+
+void chol_update_factor::update(const Eigen::RowVectorXd& x)
+{
+    ensure(x.size() == R.cols());
+
+    A.noalias() += x.transpose() * x;
+    triangular_update(R, x);
+}
+
+void chol_update_factor::downdate(const Eigen::RowVectorXd& x)
+{
+    ensure(x.size() == R.cols());
+
+    MatrixXd A1 = A;
+    A1.noalias() -= x.transpose() * x;
+    if (triangular_downdate(R, x)) {
+        A = std::move(A1);
+    }
+    else {
+        refactor(std::move(A1));
+        ++refactored;
+    }
+}
+
+void chol_update_factor::append(const Eigen::VectorXd& c)
+{
+    const Index n = R.cols();
+    ensure(c.size() == n + 1);
+
+    const VectorXd r = R.triangularView<Upper>().transpose().solve(c.head(n));
+    const double d = c(n) - r.squaredNorm();
+    ensure(d > 0); // positive definite
+
+    R.conservativeResize(n + 1, n + 1);
+    R.col(n).head(n) = r;
+    R.row(n).head(n).setZero();
+    R(n, n) = std::sqrt(d);
+
+    A.conservativeResize(n + 1, n + 1);
+    A.col(n) = c;
+    A.row(n) = c.transpose();
+}
+
+void chol_update_factor::remove(Eigen::Index j)
+{
+    const Index n = R.cols();
+    ensure(0 <= j && j < n && n > 1);
+
+    r_delete_column(R, j);
+    const auto keep = all_but(n, j);
+    A = A(keep, keep).eval();
+}
+
+qr_update_factor::qr_update_factor(const Eigen::Ref<const RowMatrixXd>& A_)
+    : a(A_.size()), m(A_.rows()), n(A_.cols())
+{
+    ensure(m >= n && n > 0);
+
+    Map<RowMatrixXd>(a.data(), m, n) = A_;
+    refactor();
+}
+
+Eigen::Map<const RowMatrixXd> qr_update_factor::A() const
+{
+    return Map<const RowMatrixXd>(a.data() + first * n, m, n);
+}
+
+namespace {
+
+    // R of A = QR for A with full column rank
+    RowMatrixXd qr_r(const Eigen::Ref<const RowMatrixXd>& A)
+    {
+        const HouseholderQR<MatrixXd> qr(A);
+        RowMatrixXd R = qr.matrixQR().topRows(A.cols()).triangularView<Upper>();
+        ensure(R.diagonal().cwiseAbs().minCoeff() > 0); // full column rank
+
+        return R;
+    }
+
+} // namespace
+
+void qr_update_factor::refactor()
+{
+    R = qr_r(A());
+}
+
+Index qr_update_factor::rows() const
+{
+    return m;
+}
+
+Index qr_update_factor::cols() const
+{
+    return n;
+}
+
+MatrixXd qr_update_factor::solve(const MatrixXd& b) const
+{
+    // Corrected seminormal equations: x = R^-1 R^-T A^T b plus one refinement step
+    const auto A = this->A();
+    const auto U = R.triangularView<Upper>();
+
+    MatrixXd x = U.solve(U.transpose().solve(A.transpose() * b));
+    const MatrixXd r = b - A * x;
+    x += U.solve(U.transpose().solve(A.transpose() * r));
+
+    return x;
+}
+
+MatrixXd qr_update_factor::U() const
+{
+    // Thin Q = A R^-1 (m×n)
+    MatrixXd Q = A();
+    R.triangularView<Upper>().solveInPlace<OnTheRight>(Q);
+
+    return Q;
+}
+
+MatrixXd qr_update_factor::V() const
+{
+    return R;
+}
+
+VectorXd qr_update_factor::values() const
+{
+    return R.diagonal();
+}
+
+double qr_update_factor::logdet() const
+{
+    return R.diagonal().array().abs().log().sum();
+}
+
+void qr_update_factor::update(const Eigen::RowVectorXd& x)
+{
+    ensure(x.size() == n);
+
+    a.insert(a.end(), x.data(), x.data() + n);
+    ++m;
+    triangular_update(R, x);
+}
+
+void qr_update_factor::downdate(const Eigen::RowVectorXd& x)
+{
+    ensure(x.size() == n && m > n);
+
+    // Oldest matching row, which is the first one in a rolling window
+    const auto A = this->A();
+    Index i = 0;
+    while (i < m && A.row(i) != x) {
+        ++i;
+    }
+    ensure(i < m);
+
+    // Downdate a copy of R, or refactor without row i, before changing the
+    // rows so a throw leaves the factorization unchanged
+    RowMatrixXd R1 = R;
+    const bool stable = triangular_downdate(R1, x);
+    if (!stable) {
+        RowMatrixXd A1(m - 1, n);
+        A1.topRows(i) = A.topRows(i);
+        A1.bottomRows(m - 1 - i) = A.bottomRows(m - 1 - i);
+        R1 = qr_r(A1);
+    }
+
+    if (i == 0) {
+        ++first;
+    }
+    else {
+        const auto row = a.begin() + (first + i) * n;
+        a.erase(row, row + n);
+    }
+    --m;
+    if (first > m) {
+        a.erase(a.begin(), a.begin() + first * n);
+        first = 0;
+    }
+    R = std::move(R1);
+    if (!stable) {
+        ++refactored;
+    }
+}
+
+void qr_update_factor::append(const Eigen::VectorXd& c)
+{
+    ensure(c.size() == m);
+
+    // r = Q^T c and ρ = ||c - Q r|| with one reorthogonalization
+    const auto A = this->A();
+    auto U = R.triangularView<Upper>();
+    VectorXd r = U.transpose().solve(A.transpose() * c);
+    VectorXd w = c - A * U.solve(r);
+    const VectorXd dr = U.transpose().solve(A.transpose() * w);
+    r += dr;
+    w -= A * U.solve(dr);
+    const double rho = w.norm();
+    ensure(rho > 0); // full column rank
+
+    std::vector<double> b(m * (n + 1));
+    Map<RowMatrixXd> B(b.data(), m, n + 1);
+    B.leftCols(n) = A;
+    B.col(n) = c;
+    a = std::move(b);
+    first = 0;
+
+    R.conservativeResize(n + 1, n + 1);
+    R.col(n).head(n) = r;
+    R.row(n).head(n).setZero();
+    R(n, n) = rho;
+    ++n;
+}
+
+void qr_update_factor::remove(Eigen::Index j)
+{
+    ensure(0 <= j && j < n && n > 1);
+
+    r_delete_column(R, j);
+
+    std::vector<double> b(m * (n - 1));
+    Map<RowMatrixXd> B(b.data(), m, n - 1);
+    B.leftCols(j) = A().leftCols(j);
+    B.rightCols(n - j - 1) = A().rightCols(n - j - 1);
+    a = std::move(b);
+    first = 0;
+    --n;
+}
+
+namespace {
+
+    // Factor A in the precision named by the optional argument
+    template<template<class> class F>
+    factor* make_factor(const Eigen::Ref<const RowMatrixXd>& A, const OPER& precision)
+    {
+        switch (option(precision, { "DOUBLE", "SINGLE" }, 0)) {
+        case 0:
+            return new F<double>(A);
+        case 1:
+            return new F<float>(A);
+        }
+
+        ensure_message(false, "precision must be DOUBLE or SINGLE");
+
+        return nullptr;
+    }
+
+} // namespace
+
+// ==============================================================================
+// Factorization Constructors (5 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.LU - LU factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_factor_lu(
+    Function(XLL_HANDLEX, "xll_factor_lu", "\\MATRIX.LU")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix."),
+        Arg(XLL_LPOPER, "precision", "is the optional storage precision \"DOUBLE\" or \"SINGLE\". Default is \"DOUBLE\".")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the LU factorization of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes LU decomposition with partial pivoting once: \[PA = LU\]</p>
+<p>MATRIX.FACTOR.U returns L, MATRIX.FACTOR.V returns U.</p>
+<p><b>Input:</b> Square matrix A(n×n)</p>
+<p>SINGLE stores the factorization in float. MATRIX.FACTOR.* results are widened to double.</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_lu(_FP12* pa, LPOPER pprecision)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(make_factor<basic_lu_factor>(fp_map(pa), *pprecision));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.CHOL - Cholesky factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_factor_chol(
+    Function(XLL_HANDLEX, "xll_factor_chol", "\\MATRIX.CHOL")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a symmetric positive-definite matrix."),
+        Arg(XLL_LPOPER, "precision", "is the optional storage precision \"DOUBLE\" or \"SINGLE\". Default is \"DOUBLE\".")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the Cholesky factorization of a SPD matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes Cholesky decomposition once: \[A = LL^T\]</p>
+<p>MATRIX.FACTOR.U returns L, MATRIX.FACTOR.V returns L^T.</p>
+<p><b>Input:</b> Symmetric positive-definite matrix A(n×n)</p>
+<p>SINGLE stores the factorization in float. MATRIX.FACTOR.* results are widened to double.</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_chol(_FP12* pa, LPOPER pprecision)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(make_factor<basic_chol_factor>(fp_map(pa), *pprecision));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.QR - QR factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_factor_qr(
+    Function(XLL_HANDLEX, "xll_factor_qr", "\\MATRIX.QR")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix."),
+        Arg(XLL_LPOPER, "precision", "is the optional storage precision \"DOUBLE\" or \"SINGLE\". Default is \"DOUBLE\".")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the QR factorization of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes QR decomposition once: \[A = QR\]</p>
+<p>MATRIX.FACTOR.U returns thin Q(m×k), MATRIX.FACTOR.V returns R(k×n), k = min(m,n).</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p>SINGLE stores the factorization in float. MATRIX.FACTOR.* results are widened to double.</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_qr(_FP12* pa, LPOPER pprecision)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(make_factor<basic_qr_factor>(fp_map(pa), *pprecision));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SVD - Singular value decomposition handle
+// -----------------------------------------------------------------------------
+AddIn xai_factor_svd(
+    Function(XLL_HANDLEX, "xll_factor_svd", "\\MATRIX.SVD")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix."),
+        Arg(XLL_LPOPER, "precision", "is the optional storage precision \"DOUBLE\" or \"SINGLE\". Default is \"DOUBLE\".")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the singular value decomposition of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes thin singular value decomposition once: \[A = U\Sigma V^T\]</p>
+<p>MATRIX.FACTOR.U returns U(m×k), MATRIX.FACTOR.V returns V(n×k),
+MATRIX.FACTOR.VALUES returns the singular values.</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p>SINGLE stores the factorization in float. MATRIX.FACTOR.* results are widened to double.</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_svd(_FP12* pa, LPOPER pprecision)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(make_factor<basic_svd_factor>(fp_map(pa), *pprecision));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.EIG - Eigendecomposition handle
+// -----------------------------------------------------------------------------
+AddIn xai_factor_eig(
+    Function(XLL_HANDLEX, "xll_factor_eig", "\\MATRIX.EIG")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix."),
+        Arg(XLL_LPOPER, "precision", "is the optional storage precision \"DOUBLE\" or \"SINGLE\". Default is \"DOUBLE\".")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the eigendecomposition of a square matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes eigenvalues and eigenvectors once: \[A = X\Lambda X^{-1}\]</p>
+<p>MATRIX.FACTOR.VALUES returns eigenvalues and MATRIX.FACTOR.U returns
+eigenvectors (real parts only), so MATRIX.EIGENVALUES and MATRIX.EIGENVECTORS
+of the same range share one solve.</p>
+<p><b>Input:</b> Square matrix A(n×n)</p>
+<p>SINGLE stores the factorization in float. MATRIX.FACTOR.* results are widened to double.</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_eig(_FP12* pa, LPOPER pprecision)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(make_factor<basic_eig_factor>(fp_map(pa), *pprecision));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// ==============================================================================
+// Factorization Accessors (5 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.SOLVE - Solve using an existing factorization
+// -----------------------------------------------------------------------------
+AddIn xai_factor_solve(
+    Function(XLL_FP, "xll_factor_solve", "MATRIX.FACTOR.SOLVE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX.* factorization."),
+        Arg(XLL_FP, "b", "is the right-hand side vector or matrix.")
+    })
+    .FunctionHelp("Solve Ax = b using a factorization handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves linear system \[Ax = b\] in O(n²) per right-hand side using the stored factorization.</p>
+<p>QR and SVD handles return the least squares solution.</p>
+<p><b>Input:</b> Factorization handle of A(m×n), b(m×p) right-hand side</p>
+<p><b>Output:</b> Solution x(n×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_factor_solve(HANDLEX _h, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+        auto b = fp_map(pb);
+
+        if (!h || h->rows() != b.rows()) {
+            return nullptr;
+        }
+
+        return eigen_to_fp(h->solve(b));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.U - Left factor
+// -----------------------------------------------------------------------------
+AddIn xai_factor_u(
+    Function(XLL_FP, "xll_factor_u", "MATRIX.FACTOR.U")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX.* factorization.")
+    })
+    .FunctionHelp("Return the left factor of a factorization handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns L for LU and Cholesky, Q for QR, U for SVD, and eigenvectors for EIG.</p>
+<p>Sparse factorization handles have no left factor.</p>
+<p><b>Input:</b> Factorization handle</p>
+<p><b>Output:</b> Left factor matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_factor_u(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        MatrixXd U = h->U();
+        return U.size() ? eigen_to_fp(U) : nullptr;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.V - Right factor
+// -----------------------------------------------------------------------------
+AddIn xai_factor_v(
+    Function(XLL_FP, "xll_factor_v", "MATRIX.FACTOR.V")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX.* factorization.")
+    })
+    .FunctionHelp("Return the right factor of a factorization handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns U for LU, L^T for Cholesky, R for QR, and V for SVD.</p>
+<p>Eigendecomposition and sparse factorization handles have no right factor.</p>
+<p><b>Input:</b> Factorization handle</p>
+<p><b>Output:</b> Right factor matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_factor_v(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        MatrixXd V = h->V();
+        return V.size() ? eigen_to_fp(V) : nullptr;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.VALUES - Diagonal, singular values, or eigenvalues
+// -----------------------------------------------------------------------------
+AddIn xai_factor_values(
+    Function(XLL_FP, "xll_factor_values", "MATRIX.FACTOR.VALUES")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX.* factorization.")
+    })
+    .FunctionHelp("Return the characteristic values of a factorization handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns the diagonal of U for LU, of L for Cholesky, of R for QR,
+the singular values for SVD, and the eigenvalues (real parts) for EIG.</p>
+<p>Sparse LU handles have no values.</p>
+<p><b>Input:</b> Factorization handle</p>
+<p><b>Output:</b> Column vector of values</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_factor_values(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        VectorXd values = h->values();
+        return values.size() ? vector_to_fp(values) : nullptr;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.LOGDET - Log absolute determinant
+// -----------------------------------------------------------------------------
+AddIn xai_factor_logdet(
+    Function(XLL_DOUBLE, "xll_factor_logdet", "MATRIX.FACTOR.LOGDET")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by a \\MATRIX.* factorization.")
+    })
+    .FunctionHelp("Return log|det(A)| from a factorization handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[\log|\det(A)|\] in O(n) from the stored factorization without overflow.</p>
+<p><b>Input:</b> Factorization handle of square A(n×n)</p>
+<p><b>Output:</b> Scalar log absolute determinant</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+double WINAPI xll_factor_logdet(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+
+        if (!h || h->rows() != h->cols()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return h->logdet();
+    }
+    catch (...) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// ==============================================================================
+// Updatable Factorizations (7 functions)
+// ==============================================================================
+
+namespace {
+
+    // Row or column vector argument
+    RowVectorXd fp_vector(const _FP12* pa)
+    {
+        ensure(pa->rows == 1 || pa->columns == 1);
+
+        return Map<const RowVectorXd>(pa->array, xll::size(*pa));
+    }
+
+    // Modifications recorded in updatable_factor::applied
+    enum class modification { update = 1, downdate, append, remove };
+
+    // The modification and its arguments
+    std::vector<double> modify_inputs(modification op, const _FP12* px)
+    {
+        std::vector<double> inputs{ static_cast<double>(op), static_cast<double>(px->rows), static_cast<double>(px->columns) };
+        inputs.insert(inputs.end(), px->array, px->array + xll::size(*px));
+
+        return inputs;
+    }
+
+    // Apply f to the updatable factorization h and return h. A cell that
+    // recalculates with the same modification leaves h unchanged.
+    template<class F>
+    HANDLEX modify(HANDLEX _h, std::vector<double> inputs, F&& f)
+    {
+        handle<factor> h(_h);
+        auto u = h ? dynamic_cast<updatable_factor*>(h.ptr()) : nullptr;
+        ensure(u);
+
+        const OPER caller = Excel(xlfCaller);
+        if (!u->applied.repeated(caller, inputs)) {
+            f(*u);
+            u->applied.record(caller, std::move(inputs));
+        }
+
+        return _h;
+    }
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// \MATRIX.CHOL.UPDATABLE - Cholesky factorization with O(n²) updates
+// -----------------------------------------------------------------------------
+AddIn xai_factor_chol_updatable(
+    Function(XLL_HANDLEX, "xll_factor_chol_updatable", "\\MATRIX.CHOL.UPDATABLE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a symmetric positive-definite matrix.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a Cholesky factorization that can be updated in place.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A = R^T R\] once. MATRIX.FACTOR.UPDATE, MATRIX.FACTOR.DOWNDATE,
+MATRIX.FACTOR.APPEND and MATRIX.FACTOR.DELETE then modify R in O(n²). For a
+rolling window pass the Gram matrix X^T X and update with the arriving row and
+downdate with the departing one.</p>
+<p>MATRIX.FACTOR.U returns L = R^T, MATRIX.FACTOR.V returns R.</p>
+<p><b>Input:</b> Symmetric positive-definite matrix A(n×n)</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_chol_updatable(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(new chol_update_factor(fp_map(pa)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.QR.UPDATABLE - QR factorization with O(n²) updates
+// -----------------------------------------------------------------------------
+AddIn xai_factor_qr_updatable(
+    Function(XLL_HANDLEX, "xll_factor_qr_updatable", "\\MATRIX.QR.UPDATABLE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix with at least as many rows as columns and full column rank.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a QR factorization that can be updated in place.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A = QR\] once and keeps R and the rows of A. MATRIX.FACTOR.UPDATE
+appends a row and MATRIX.FACTOR.DOWNDATE deletes the oldest row equal to its
+argument, each in O(n²). MATRIX.FACTOR.APPEND and MATRIX.FACTOR.DELETE add and
+remove columns.</p>
+<p>MATRIX.FACTOR.SOLVE returns the least squares solution using the corrected
+seminormal equations. MATRIX.FACTOR.U returns Q = AR^-1(m×n), MATRIX.FACTOR.V
+returns R(n×n).</p>
+<p><b>Input:</b> Matrix A(m×n), m ≥ n</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_qr_updatable(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(new qr_update_factor(fp_map(pa)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.UPDATE - Add a row
+// -----------------------------------------------------------------------------
+AddIn xai_factor_update(
+    Function(XLL_HANDLEX, "xll_factor_update", "MATRIX.FACTOR.UPDATE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.CHOL.UPDATABLE or \\MATRIX.QR.UPDATABLE."),
+        Arg(XLL_FP, "x", "is the row to add.")
+    })
+    .FunctionHelp("Add a row to an updatable factorization and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Replaces A by \[A + x^T x\] for Cholesky handles and appends row x to A for
+QR handles, in O(n²) with Givens rotations.</p>
+<p>Each cell applies its row once. Recalculating the cell with the same handle
+and x leaves the handle unchanged, and changing x adds the new row. Pass the
+result to the next modification or accessor so Excel orders them.</p>
+<p><b>Input:</b> Updatable handle, x(1×n) or x(n×1)</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_update(HANDLEX _h, _FP12* px)
+{
+#pragma XLLEXPORT
+    try {
+        return modify(_h, modify_inputs(modification::update, px), [px](updatable_factor& u) { u.update(fp_vector(px)); });
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.DOWNDATE - Remove a row
+// -----------------------------------------------------------------------------
+AddIn xai_factor_downdate(
+    Function(XLL_HANDLEX, "xll_factor_downdate", "MATRIX.FACTOR.DOWNDATE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.CHOL.UPDATABLE or \\MATRIX.QR.UPDATABLE."),
+        Arg(XLL_FP, "x", "is the row to remove.")
+    })
+    .FunctionHelp("Remove a row from an updatable factorization and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Replaces A by \[A - x^T x\] for Cholesky handles and deletes the oldest row
+equal to x for QR handles, in O(n²).</p>
+<p>A downdate is unstable when \[1 - \|R^{-T}x^T\|^2\] is small. Those are done by
+refactoring the modified matrix instead and counted by
+MATRIX.FACTOR.REFACTORIZATIONS. Returns #NUM! and leaves the handle unchanged if
+a Cholesky downdate makes A indefinite.</p>
+<p>Recalculating the cell with the same handle and arguments leaves the handle
+unchanged.</p>
+<p><b>Input:</b> Updatable handle, x(1×n) or x(n×1)</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_downdate(HANDLEX _h, _FP12* px)
+{
+#pragma XLLEXPORT
+    try {
+        return modify(_h, modify_inputs(modification::downdate, px), [px](updatable_factor& u) { u.downdate(fp_vector(px)); });
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.APPEND - Add a column
+// -----------------------------------------------------------------------------
+AddIn xai_factor_append(
+    Function(XLL_HANDLEX, "xll_factor_append", "MATRIX.FACTOR.APPEND")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.CHOL.UPDATABLE or \\MATRIX.QR.UPDATABLE."),
+        Arg(XLL_FP, "c", "is the column to append.")
+    })
+    .FunctionHelp("Append a column to an updatable factorization and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>For Cholesky handles c(n+1) borders A with a new last row and column whose
+diagonal entry is the last entry of c, in O(n²). For QR handles c(m) becomes the
+last column of A and R gains a column, in O(mn).</p>
+<p>Recalculating the cell with the same handle and arguments leaves the handle
+unchanged.</p>
+<p><b>Input:</b> Updatable handle, column c</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_append(HANDLEX _h, _FP12* pc)
+{
+#pragma XLLEXPORT
+    try {
+        return modify(_h, modify_inputs(modification::append, pc), [pc](updatable_factor& u) { u.append(fp_vector(pc).transpose()); });
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.DELETE - Remove a column
+// -----------------------------------------------------------------------------
+AddIn xai_factor_delete(
+    Function(XLL_HANDLEX, "xll_factor_delete", "MATRIX.FACTOR.DELETE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.CHOL.UPDATABLE or \\MATRIX.QR.UPDATABLE."),
+        Arg(XLL_DOUBLE, "j", "is the 1-based index of the column to delete.")
+    })
+    .FunctionHelp("Delete a column from an updatable factorization and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Deletes column j of A, and row j for Cholesky handles. R loses column j and
+is made triangular again with n - j Givens rotations, in O(n²).</p>
+<p>Recalculating the cell with the same handle and arguments leaves the handle
+unchanged.</p>
+<p><b>Input:</b> Updatable handle, column index j</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_factor_delete(HANDLEX _h, double j)
+{
+#pragma XLLEXPORT
+    try {
+        const Index k = to_index(j) - 1;
+        ensure(k >= 0);
+
+        return modify(_h, { static_cast<double>(modification::remove), static_cast<double>(k) }, [k](updatable_factor& u) { u.remove(k); });
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.FACTOR.REFACTORIZATIONS - Unstable downdates
+// -----------------------------------------------------------------------------
+AddIn xai_factor_refactorizations(
+    Function(XLL_DOUBLE, "xll_factor_refactorizations", "MATRIX.FACTOR.REFACTORIZATIONS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.CHOL.UPDATABLE or \\MATRIX.QR.UPDATABLE.")
+    })
+    .FunctionHelp("Return the number of downdates that refactored instead.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Counts the downdates that recomputed the factorization in O(n³) because the
+O(n²) downdate would have lost accuracy.</p>
+<p><b>Input:</b> Updatable handle</p>
+<p><b>Output:</b> Scalar count</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+double WINAPI xll_factor_refactorizations(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<factor> h(_h);
+        auto u = h ? dynamic_cast<updatable_factor*>(h.ptr()) : nullptr;
+
+        return u ? static_cast<double>(u->refactorizations()) : std::numeric_limits<double>::quiet_NaN();
+    }
+    catch (...) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
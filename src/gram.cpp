@@ -0,0 +1,272 @@
+// ==============================================================================
+// gram.cpp - Covariance, correlation and Gram matrices
+// ==============================================================================
+// MATRIX.GRAM, MATRIX.COV and MATRIX.CORR replace
+// MATRIX.MUL(MATRIX.TRANSPOSE(X), X) for tall X.
+// ==============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "gram.h"
+#include "async.h"
+
+using namespace xll;
+using namespace Eigen;
+
+namespace {
+
+    // Rows per block so a block of X stays in a 256KB L2 cache
+    Index block_rows(Index n)
+    {
+        return std::clamp<Index>((256 * 1024) / (8 * n), 64, 4096);
+    }
+
+    // Move the mean of m to include rows with mean b and total weight W.
+    // The scatter gains the between-group term W_a W / (W_a + W) δ^T δ.
+    void merge_mean(gram_moments& m, const RowVectorXd& b, double W)
+    {
+        if (m.weight == 0) {
+            m.mean = b;
+            return;
+        }
+
+        const double total = m.weight + W;
+        const RowVectorXd delta = b - m.mean;
+        m.scatter.selfadjointView<Lower>().rankUpdate(delta.transpose(), m.weight * W / total);
+        m.mean += delta * (W / total);
+    }
+
+    // Fold rows [r0, r1) of X into m using C as scratch
+    void accumulate(gram_moments& m, const Eigen::Ref<const RowMatrixXd>& X, const double* w, bool demean,
+        Index r0, Index r1, RowMatrixXd& C)
+    {
+        const auto B = X.middleRows(r0, r1 - r0);
+        double W = static_cast<double>(B.rows());
+        double W2 = W;
+        RowVectorXd mean;
+
+        if (w) {
+            const Map<const ArrayXd> wb(w + r0, B.rows());
+            W = wb.sum();
+            W2 = wb.square().sum();
+            if (W == 0) {
+                return;
+            }
+            if (demean) {
+                mean = (wb.matrix().transpose() * B) / W;
+                C = (B.rowwise() - mean).array().colwise() * wb.sqrt();
+            }
+            else {
+                C = B.array().colwise() * wb.sqrt();
+            }
+            m.scatter.selfadjointView<Lower>().rankUpdate(C.transpose());
+        }
+        else if (demean) {
+            mean = B.colwise().mean();
+            C = B.rowwise() - mean;
+            m.scatter.selfadjointView<Lower>().rankUpdate(C.transpose());
+        }
+        else {
+            m.scatter.selfadjointView<Lower>().rankUpdate(B.transpose());
+        }
+
+        if (demean) {
+            merge_mean(m, mean, W);
+        }
+        m.weight += W;
+        m.weight2 += W2;
+    }
+
+    // Moments from the X, weights and demean arguments
+    gram_moments moments(const _FP12* px, const OPER& weights, const OPER& demean, bool init)
+    {
+        auto X = fp_map(px);
+
+        VectorXd w;
+        if (!isMissing(weights) && !isNil(weights)) {
+            ensure(size(weights) == X.rows());
+            w.resize(X.rows());
+            for (Index i = 0; i < X.rows(); ++i) {
+                const OPER& wi = weights[static_cast<int>(i)];
+                ensure(isNum(wi) && Num(wi) >= 0);
+                w(i) = Num(wi);
+            }
+        }
+
+        return accumulate_gram(X, w.size() ? w.data() : nullptr,
+            isMissing(demean) || isNil(demean) ? init : isTrue(demean));
+    }
+
+} // namespace
+
+gram_moments xll::accumulate_gram(const Eigen::Ref<const RowMatrixXd>& X, const double* w, bool demean)
+{
+    const Index n = X.cols();
+    const Index rows = block_rows(n);
+    const Index blocks = (X.rows() + rows - 1) / rows;
+    const Index parts = (std::min<Index>)(blocks, linalg_pool().threads() + 1);
+
+    std::vector<gram_moments> part(parts, gram_moments(n));
+    parallel_for(parts, 1, [&](Index b, Index e) {
+        RowMatrixXd C;
+        for (Index p = b; p < e; ++p) {
+            const Index first = blocks * p / parts;
+            const Index last = blocks * (p + 1) / parts;
+            for (Index k = first; k < last; ++k) {
+                accumulate(part[p], X, w, demean, k * rows, (std::min)(X.rows(), (k + 1) * rows), C);
+            }
+        }
+    });
+
+    gram_moments m(n);
+    for (const auto& q : part) {
+        if (q.weight == 0) {
+            continue;
+        }
+        m.scatter.triangularView<Lower>() += q.scatter;
+        if (demean) {
+            merge_mean(m, q.mean, q.weight);
+        }
+        m.weight += q.weight;
+        m.weight2 += q.weight2;
+    }
+
+    return m;
+}
+
+// ==============================================================================
+// Second Moment Functions (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.GRAM - Gram matrix X^T W X
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_gram(
+    Function(XLL_FP, "xll_matrix_gram", "MATRIX.GRAM")
+    .Arguments({
+        Arg(XLL_FP, "X", "is a matrix with observations in rows."),
+        Arg(XLL_LPOPER, "weights", "is an optional nonnegative weight for each row."),
+        Arg(XLL_LPOPER, "demean", "is an optional boolean to subtract the weighted column means first. Default is FALSE.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the Gram matrix X^T X without forming the transpose.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[X^T W X\] with W = diag(weights), or the scatter matrix of the
+centered rows if demean is TRUE. Only the lower triangle is accumulated, over
+cache-sized row blocks in parallel, and the result is mirrored.</p>
+<p><b>Input:</b> X(m×n), optional weights(m)</p>
+<p><b>Output:</b> Symmetric matrix (n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_gram(_FP12* px, LPOPER pweights, LPOPER pdemean)
+{
+#pragma XLLEXPORT
+    try {
+        const auto m = moments(px, *pweights, *pdemean, false);
+
+        return eigen_to_fp(m.scatter.selfadjointView<Lower>());
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.COV - Covariance matrix of the columns
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_cov(
+    Function(XLL_FP, "xll_matrix_cov", "MATRIX.COV")
+    .Arguments({
+        Arg(XLL_FP, "X", "is a matrix with observations in rows."),
+        Arg(XLL_LPOPER, "weights", "is an optional nonnegative weight for each row."),
+        Arg(XLL_LPOPER, "demean", "is an optional boolean to subtract the weighted column means. Default is TRUE.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the sample covariance matrix of the columns of X.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes the unbiased weighted covariance
+\[\Sigma = \frac{\sum_i w_i (x_i - \bar{x})^T (x_i - \bar{x})}{V_1 - V_2 / V_1}\]
+with \[V_1 = \sum_i w_i\] and \[V_2 = \sum_i w_i^2\]. Unit weights give the usual
+m - 1 denominator. If demean is FALSE the mean is taken to be zero and the
+denominator is \[V_1\].</p>
+<p><b>Input:</b> X(m×n), optional weights(m)</p>
+<p><b>Output:</b> Covariance matrix (n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_cov(_FP12* px, LPOPER pweights, LPOPER pdemean)
+{
+#pragma XLLEXPORT
+    try {
+        const bool demean = isMissing(*pdemean) || isNil(*pdemean) || isTrue(*pdemean);
+        const auto m = moments(px, *pweights, *pdemean, true);
+        const double denominator = demean ? m.weight - m.weight2 / m.weight : m.weight;
+        if (!(denominator > 0)) {
+            return nullptr;
+        }
+
+        _FP12* result = eigen_to_fp(m.scatter.selfadjointView<Lower>());
+        fp_out(result) /= denominator;
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.CORR - Correlation matrix of the columns
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_corr(
+    Function(XLL_FP, "xll_matrix_corr", "MATRIX.CORR")
+    .Arguments({
+        Arg(XLL_FP, "X", "is a matrix with observations in rows."),
+        Arg(XLL_LPOPER, "weights", "is an optional nonnegative weight for each row."),
+        Arg(XLL_LPOPER, "demean", "is an optional boolean to subtract the weighted column means. Default is TRUE.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the correlation matrix of the columns of X.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[D^{-1/2} S D^{-1/2}\] where S is the weighted scatter matrix and
+D its diagonal. If demean is FALSE this is the uncentered (cosine) correlation.
+Constant columns return #NUM!.</p>
+<p><b>Input:</b> X(m×n), optional weights(m)</p>
+<p><b>Output:</b> Correlation matrix (n×n) with unit diagonal</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_corr(_FP12* px, LPOPER pweights, LPOPER pdemean)
+{
+#pragma XLLEXPORT
+    try {
+        const auto m = moments(px, *pweights, *pdemean, true);
+        const VectorXd d = m.scatter.diagonal().cwiseSqrt().cwiseInverse();
+
+        _FP12* result = eigen_to_fp(d.asDiagonal() * MatrixXd(m.scatter.selfadjointView<Lower>()) * d.asDiagonal());
+        for (Index j = 0; j < d.size(); ++j) {
+            if (std::isfinite(d(j))) {
+                fp_out(result)(j, j) = 1;
+            }
+        }
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
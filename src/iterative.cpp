@@ -0,0 +1,698 @@
+// ==============================================================================
+// iterative.cpp - Preconditioned Krylov solvers
+// ==============================================================================
+// MATRIX.SOLVE.ITER solves A x = b with CG, BiCGSTAB, or GMRES where A is a
+// dense range, a sparse handle, or a matrix-free operator handle returned by
+// \MATRIX.OPERATOR.NORMAL or \MATRIX.OPERATOR.LOWRANK.
+// ==============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <map>
+#include "iterative.h"
+
+using namespace xll;
+using namespace Eigen;
+
+// ==============================================================================
+// Operator Implementations
+// ==============================================================================
+
+Index normal_operator::rows() const
+{
+    return A->cols();
+}
+
+Index normal_operator::cols() const
+{
+    return A->cols();
+}
+
+void normal_operator::apply(const VectorXd& x, VectorXd& y) const
+{
+    VectorXd Ax;
+    A->apply(x, Ax);
+    A->apply_transpose(Ax, y);
+    y += lambda * x;
+}
+
+void normal_operator::apply_transpose(const VectorXd& x, VectorXd& y) const
+{
+    apply(x, y); // symmetric
+}
+
+VectorXd normal_operator::diagonal() const
+{
+    return d;
+}
+
+lowrank_operator::lowrank_operator(VectorXd d_, MatrixXd U_, MatrixXd V_)
+    : d(std::move(d_)), U(std::move(U_)), V(std::move(V_))
+{
+    ensure(U.rows() == d.size() && V.rows() == d.size() && U.cols() == V.cols());
+}
+
+Index lowrank_operator::rows() const
+{
+    return d.size();
+}
+
+Index lowrank_operator::cols() const
+{
+    return d.size();
+}
+
+void lowrank_operator::apply(const VectorXd& x, VectorXd& y) const
+{
+    y = d.cwiseProduct(x);
+    y.noalias() += U * (V.transpose() * x);
+}
+
+void lowrank_operator::apply_transpose(const VectorXd& x, VectorXd& y) const
+{
+    y = d.cwiseProduct(x);
+    y.noalias() += V * (U.transpose() * x);
+}
+
+VectorXd lowrank_operator::diagonal() const
+{
+    return d + U.cwiseProduct(V).rowwise().sum();
+}
+
+namespace {
+
+    // Operator looked up from a handle argument. The lookup is kept for as
+    // long as the operator is used because destroying it erases a temporary
+    // handle, one returned by a nested call in the same cell.
+    template<class T>
+    class handle_operator : public linear_operator {
+        handle<T> h;
+        std::unique_ptr<linear_operator> view; // sparse handles only
+        const linear_operator* A = nullptr;
+    public:
+        explicit handle_operator(HANDLEX x)
+            : h(x)
+        {
+            if constexpr (std::is_same_v<T, sparse_matrix>) {
+                if (h) {
+                    view.reset(new sparse_view_operator(*h));
+                    A = view.get();
+                }
+            }
+            else {
+                A = h.ptr();
+            }
+        }
+        explicit operator bool() const
+        {
+            return A != nullptr;
+        }
+
+        Index rows() const override
+        {
+            return A->rows();
+        }
+        Index cols() const override
+        {
+            return A->cols();
+        }
+        void apply(const VectorXd& x, VectorXd& y) const override
+        {
+            A->apply(x, y);
+        }
+        void apply_transpose(const VectorXd& x, VectorXd& y) const override
+        {
+            A->apply_transpose(x, y);
+        }
+        VectorXd diagonal() const override
+        {
+            return A->diagonal();
+        }
+        sparse_matrix to_sparse() const override
+        {
+            return A->to_sparse();
+        }
+    };
+
+} // namespace
+
+const linear_operator* xll::fp_operator(const _FP12* pa, std::unique_ptr<linear_operator>& view)
+{
+    if (xll::size(*pa) == 1 && is_handle(pa->array[0])) {
+        if (auto s = std::make_unique<handle_operator<sparse_matrix>>(pa->array[0]); *s) {
+            view = std::move(s);
+
+            return view.get();
+        }
+        if (auto h = std::make_unique<handle_operator<linear_operator>>(pa->array[0]); *h) {
+            view = std::move(h);
+
+            return view.get();
+        }
+    }
+
+    // Ranges and dense handles, including strided views. The view owns a
+    // reference to the storage of a dense handle.
+    view.reset(new dense_view_operator(dense_map(pa)));
+
+    return view.get();
+}
+
+// ==============================================================================
+// Preconditioner Implementations
+// ==============================================================================
+
+namespace {
+
+    class identity_preconditioner : public preconditioner {
+    public:
+        void solve(const VectorXd& r, VectorXd& z) const override
+        {
+            z = r;
+        }
+    };
+
+    class jacobi_preconditioner : public preconditioner {
+        VectorXd inv_d;
+    public:
+        explicit jacobi_preconditioner(const VectorXd& d)
+            : inv_d(d.unaryExpr([](double x) { return x != 0 ? 1 / x : 1.; }))
+        { }
+        void solve(const VectorXd& r, VectorXd& z) const override
+        {
+            z = inv_d.cwiseProduct(r);
+        }
+    };
+
+    // Wrap an Eigen incomplete factorization
+    template<class P>
+    class incomplete_preconditioner : public preconditioner {
+        P p;
+    public:
+        explicit incomplete_preconditioner(const sparse_matrix& A)
+        {
+            p.compute(A);
+            ensure(p.info() == Success);
+        }
+        void solve(const VectorXd& r, VectorXd& z) const override
+        {
+            z = p.solve(r);
+        }
+    };
+
+} // namespace
+
+std::unique_ptr<preconditioner> xll::make_preconditioner(const linear_operator& A, preconditioner_type type)
+{
+    switch (type) {
+    case preconditioner_type::jacobi:
+        return std::make_unique<jacobi_preconditioner>(A.diagonal());
+    case preconditioner_type::ic:
+        return std::make_unique<incomplete_preconditioner<IncompleteCholesky<double>>>(A.to_sparse());
+    case preconditioner_type::ilut:
+        return std::make_unique<incomplete_preconditioner<IncompleteLUT<double>>>(A.to_sparse());
+    default:
+        return std::make_unique<identity_preconditioner>();
+    }
+}
+
+// ==============================================================================
+// Krylov Solvers
+// ==============================================================================
+
+namespace {
+
+    // Preconditioned conjugate gradient for symmetric positive-definite A
+    int cg(const linear_operator& A, const preconditioner& M, const VectorXd& b, VectorXd& x, double eps, int maxiter)
+    {
+        VectorXd r, z, Ap;
+        A.apply(x, r);
+        r = b - r;
+        M.solve(r, z);
+        VectorXd p = z;
+        double rz = r.dot(z);
+
+        int k = 0;
+        for (; k < maxiter && r.norm() > eps; ++k) {
+            A.apply(p, Ap);
+            const double pAp = p.dot(Ap);
+            if (!(pAp > 0)) {
+                break; // A is not positive definite along p
+            }
+            const double alpha = rz / pAp;
+            x += alpha * p;
+            r -= alpha * Ap;
+
+            M.solve(r, z);
+            const double rz_ = r.dot(z);
+            if (rz_ == 0) {
+                return k + 1; // converged, or M is not positive definite
+            }
+            p = z + (rz_ / rz) * p;
+            rz = rz_;
+        }
+
+        return k;
+    }
+
+    // Right preconditioned BiCGSTAB for general A
+    int bicgstab(const linear_operator& A, const preconditioner& M, const VectorXd& b, VectorXd& x, double eps, int maxiter)
+    {
+        const Index n = b.size();
+        VectorXd r, y, z, s, t;
+        A.apply(x, r);
+        r = b - r;
+        VectorXd r0 = r;
+        VectorXd v = VectorXd::Zero(n);
+        VectorXd p = VectorXd::Zero(n);
+        double rho = 1, alpha = 1, omega = 1;
+
+        int k = 0;
+        for (; k < maxiter && r.norm() > eps; ++k) {
+            double rho_ = r0.dot(r);
+            if (std::fabs(rho_) < 1e-30 * r0.squaredNorm()) {
+                // r has become orthogonal to r0 so restart
+                A.apply(x, r);
+                r = b - r;
+                r0 = r;
+                rho_ = r.squaredNorm();
+                v.setZero();
+                p.setZero();
+                alpha = omega = 1;
+            }
+            const double beta = (rho_ / rho) * (alpha / omega);
+            rho = rho_;
+
+            p = r + beta * (p - omega * v);
+            M.solve(p, y);
+            A.apply(y, v);
+            alpha = rho / r0.dot(v);
+            s = r - alpha * v;
+
+            M.solve(s, z);
+            A.apply(z, t);
+            const double tt = t.squaredNorm();
+            omega = tt > 0 ? t.dot(s) / tt : 0;
+
+            x += alpha * y + omega * z;
+            r = s - omega * t;
+            if (omega == 0) {
+                return k + 1; // stagnated
+            }
+        }
+
+        return k;
+    }
+
+    // Right preconditioned GMRES restarted every gmres_restart iterations
+    int gmres(const linear_operator& A, const preconditioner& M, const VectorXd& b, VectorXd& x, double eps, int maxiter)
+    {
+        const Index n = b.size();
+        const int m = static_cast<int>((std::min<Index>)(gmres_restart, n));
+        MatrixXd V(n, m + 1);
+        MatrixXd H = MatrixXd::Zero(m + 1, m);
+        VectorXd g(m + 1), cs(m), sn(m), r, w, z;
+
+        int k = 0;
+        while (k < maxiter) {
+            A.apply(x, r);
+            r = b - r;
+            const double beta = r.norm();
+            if (beta <= eps) {
+                break;
+            }
+
+            V.col(0) = r / beta;
+            g.setZero();
+            g(0) = beta;
+            H.setZero();
+
+            int j = 0;
+            while (j < m && k < maxiter) {
+                ++k;
+                M.solve(V.col(j), z);
+                A.apply(z, w);
+
+                // Modified Gram-Schmidt
+                for (int i = 0; i <= j; ++i) {
+                    H(i, j) = w.dot(V.col(i));
+                    w -= H(i, j) * V.col(i);
+                }
+                const double h = w.norm();
+                H(j + 1, j) = h;
+                if (h > 0) {
+                    V.col(j + 1) = w / h;
+                }
+
+                // Apply previous Givens rotations then zero H(j + 1, j)
+                for (int i = 0; i < j; ++i) {
+                    const double Hij = cs(i) * H(i, j) + sn(i) * H(i + 1, j);
+                    H(i + 1, j) = -sn(i) * H(i, j) + cs(i) * H(i + 1, j);
+                    H(i, j) = Hij;
+                }
+                const double rho = std::hypot(H(j, j), H(j + 1, j));
+                cs(j) = rho > 0 ? H(j, j) / rho : 1;
+                sn(j) = rho > 0 ? H(j + 1, j) / rho : 0;
+                H(j, j) = rho;
+                H(j + 1, j) = 0;
+                g(j + 1) = -sn(j) * g(j);
+                g(j) = cs(j) * g(j);
+
+                ++j;
+                if (std::fabs(g(j)) <= eps || h == 0) { // converged or Krylov space is invariant
+                    break;
+                }
+            }
+
+            const VectorXd y = H.topLeftCorner(j, j).triangularView<Upper>().solve(g.head(j));
+            M.solve(V.leftCols(j) * y, z);
+            x += z;
+
+            if (std::fabs(g(j)) <= eps) {
+                break;
+            }
+        }
+
+        return k;
+    }
+
+} // namespace
+
+iterative_result xll::iterative_solve(const linear_operator& A, const preconditioner& M,
+    const VectorXd& b, VectorXd& x, iterative_method method, double tol, int maxiter)
+{
+    ensure(A.rows() == A.cols() && A.rows() == b.size());
+
+    const double bnorm = b.norm();
+    if (bnorm == 0) {
+        x.setZero(b.size());
+
+        return { 0, 0 };
+    }
+    if (x.size() != b.size()) {
+        x.setZero(b.size());
+    }
+
+    const double eps = tol * bnorm;
+    int iterations = 0;
+    switch (method) {
+    case iterative_method::cg:
+        iterations = cg(A, M, b, x, eps, maxiter);
+        break;
+    case iterative_method::bicgstab:
+        iterations = bicgstab(A, M, b, x, eps, maxiter);
+        break;
+    case iterative_method::gmres:
+        iterations = gmres(A, M, b, x, eps, maxiter);
+        break;
+    }
+
+    // True residual rather than the recurrence estimate
+    VectorXd r;
+    A.apply(x, r);
+
+    return { iterations, (b - r).norm() / bnorm };
+}
+
+// ==============================================================================
+// Excel Functions (4 functions)
+// ==============================================================================
+
+namespace {
+
+    // Elements of all warm start solutions kept by MATRIX.SOLVE.ITER
+    constexpr Index warm_start_budget = Index(1) << 24;
+
+    // Last solution computed in each calling cell. The oldest callers are
+    // dropped once the solutions exceed warm_start_budget elements, so cells
+    // that were deleted or moved do not keep theirs forever.
+    class warm_starts {
+        std::map<OPER, MatrixXd> x;
+        std::deque<OPER> order; // callers, oldest first
+        Index size = 0;
+    public:
+        const MatrixXd* find(const OPER& caller) const
+        {
+            const auto i = x.find(caller);
+
+            return i == x.end() ? nullptr : &i->second;
+        }
+        void insert(const OPER& caller, MatrixXd X)
+        {
+            if (X.size() > warm_start_budget) {
+                return;
+            }
+
+            if (auto i = x.find(caller); i != x.end()) {
+                size -= i->second.size();
+                i->second = std::move(X);
+                size += i->second.size();
+            }
+            else {
+                size += X.size();
+                x.emplace(caller, std::move(X));
+                order.push_back(caller);
+            }
+
+            while (size > warm_start_budget) {
+                const auto i = x.find(order.front());
+                size -= i->second.size();
+                x.erase(i);
+                order.pop_front();
+            }
+        }
+    };
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// MATRIX.SOLVE.ITER - Preconditioned iterative solve
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_solve_iter(
+    Function(XLL_FP, "xll_matrix_solve_iter", "MATRIX.SOLVE.ITER")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix, dense handle, sparse handle, or operator handle."),
+        Arg(XLL_FP, "b", "is the right-hand side vector or matrix."),
+        Arg(XLL_LPOPER, "method", "is the optional method \"CG\", \"BICGSTAB\", or \"GMRES\". Default is \"BICGSTAB\"."),
+        Arg(XLL_LPOPER, "precond", "is the optional preconditioner \"NONE\", \"JACOBI\", \"IC\", or \"ILUT\". Default is \"JACOBI\"."),
+        Arg(XLL_DOUBLE, "tol", "is the optional relative residual tolerance. Default is 1e-10."),
+        Arg(XLL_DOUBLE, "maxiter", "is the optional maximum number of iterations. Default is 2n. At most 2^31 - 1."),
+        Arg(XLL_LPOPER, "warm", "is an optional boolean to start from the previous solution in this cell. Default is TRUE.")
+    })
+    .FunctionHelp("Solve Ax = b with a preconditioned Krylov method.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves linear system \[Ax = b\] using only products with A, so cost per
+iteration is O(nnz) for sparse handles and operators.</p>
+<p>CG requires symmetric positive-definite A and stops early if it finds A is not. BiCGSTAB and GMRES (restarted
+every 30 iterations) handle general A. IC (incomplete Cholesky) and ILUT
+(incomplete LU with threshold) need the entries of A and are not available
+for matrix-free operators.</p>
+<p>The previous solution computed in the calling cell is used as the starting
+point when its dimensions match, so small changes to A or b converge in a few
+iterations. Solutions with 2<sup>24</sup> elements in total are kept, and those of
+the cells that solved first are dropped first.</p>
+<p><b>Input:</b> A(n×n), b(n×p) right-hand side</p>
+<p><b>Output:</b> Solution x(n×p) followed by a row of iteration counts and a row of relative residuals ((n+2)×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_solve_iter(_FP12* pa, _FP12* pb, LPOPER pmethod, LPOPER pprecond, double tol, double maxiter, LPOPER pwarm)
+{
+#pragma XLLEXPORT
+    static warm_starts warm_start;
+
+    try {
+        std::unique_ptr<linear_operator> view;
+        const linear_operator* A = fp_operator(pa, view);
+        auto b = fp_map(pb);
+
+        const Index n = A->rows();
+        if (A->cols() != n || b.rows() != n) {
+            return nullptr;
+        }
+
+        const int method = option(*pmethod, { "CG", "BICGSTAB", "GMRES" }, 1);
+        const int precond = option(*pprecond, { "NONE", "JACOBI", "IC", "ILUT" }, 1);
+        if (method < 0 || method > 2 || precond < 0 || precond > 3) {
+            return nullptr;
+        }
+        if (tol <= 0) {
+            tol = 1e-10;
+        }
+        // Clamped to [1, INT_MAX] before converting
+        constexpr double most = (std::numeric_limits<int>::max)();
+        const int iterations = static_cast<int>((std::min)(maxiter > 0 ? (std::max)(maxiter, 1.) : 2 * static_cast<double>(n), most));
+
+        auto M = make_preconditioner(*A, static_cast<preconditioner_type>(precond));
+
+        const bool warm = isMissing(*pwarm) || isNil(*pwarm) || isTrue(*pwarm);
+        const OPER caller = Excel(xlfCaller);
+        MatrixXd X;
+        if (warm) {
+            if (const MatrixXd* X0 = warm_start.find(caller); X0 && X0->rows() == n && X0->cols() == b.cols()) {
+                X = *X0;
+            }
+        }
+        if (X.size() == 0) {
+            X = MatrixXd::Zero(n, b.cols());
+        }
+
+        _FP12* result = fp_alloc(n + 2, b.cols());
+        auto R = fp_out(result);
+        for (Index j = 0; j < b.cols(); ++j) {
+            VectorXd x = X.col(j);
+            const auto info = iterative_solve(*A, *M, b.col(j), x,
+                static_cast<iterative_method>(method), tol, iterations);
+            X.col(j) = x;
+            R.col(j).head(n) = x;
+            R(n, j) = info.iterations;
+            R(n + 1, j) = info.residual;
+        }
+
+        if (warm) {
+            warm_start.insert(caller, std::move(X));
+        }
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.OPERATOR.NORMAL - Matrix-free normal equations operator
+// -----------------------------------------------------------------------------
+AddIn xai_operator_normal(
+    Function(XLL_HANDLEX, "xll_operator_normal", "\\MATRIX.OPERATOR.NORMAL")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix, dense handle, or sparse handle."),
+        Arg(XLL_DOUBLE, "lambda", "is the optional ridge parameter. Default is 0.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the operator x -> A^T A x + lambda x.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Applies \[(A^TA + \lambda I)x = A^T(Ax) + \lambda x\] without forming A^T A,
+so each product costs O(nnz(A)). Solve the normal equations with
+MATRIX.SOLVE.ITER(h, A^T b, "CG").</p>
+<p><b>Input:</b> Matrix or sparse handle A(m×n), ridge parameter λ ≥ 0</p>
+<p><b>Output:</b> Handle to the n×n operator</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_operator_normal(_FP12* pa, double lambda)
+{
+#pragma XLLEXPORT
+    try {
+        ensure(lambda >= 0);
+
+        if (xll::size(*pa) == 1 && is_handle(pa->array[0])) {
+            if (handle<sparse_matrix> s(pa->array[0]); s) {
+                handle<linear_operator> h(new normal_operator(sparse_matrix(*s), lambda));
+                return h.get();
+            }
+        }
+
+        // The view keeps the storage of a temporary handle alive until it is copied
+        handle<linear_operator> h(new normal_operator(RowMatrixXd(dense_map(pa)), lambda));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.OPERATOR.LOWRANK - Matrix-free diagonal plus low rank operator
+// -----------------------------------------------------------------------------
+AddIn xai_operator_lowrank(
+    Function(XLL_HANDLEX, "xll_operator_lowrank", "\\MATRIX.OPERATOR.LOWRANK")
+    .Arguments({
+        Arg(XLL_FP, "d", "is the diagonal vector."),
+        Arg(XLL_FP, "U", "is the n×k left factor."),
+        Arg(XLL_FP, "V", "is the n×k right factor.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the operator x -> diag(d) x + U V^T x.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Applies \[(D + UV^T)x\] in O(nk) without forming the n×n matrix.</p>
+<p><b>Input:</b> Diagonal d(n), factors U(n×k) and V(n×k)</p>
+<p><b>Output:</b> Handle to the n×n operator</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_operator_lowrank(_FP12* pd, _FP12* pu, _FP12* pv)
+{
+#pragma XLLEXPORT
+    try {
+        const VectorXd d = fp_map(pd).reshaped<RowMajor>();
+
+        handle<linear_operator> h(new lowrank_operator(d, fp_map(pu), fp_map(pv)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.OPERATOR.APPLY - Apply an operator
+// -----------------------------------------------------------------------------
+AddIn xai_operator_apply(
+    Function(XLL_FP, "xll_operator_apply", "MATRIX.OPERATOR.APPLY")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a matrix, dense handle, sparse handle, or operator handle."),
+        Arg(XLL_FP, "x", "is a vector or matrix.")
+    })
+    .FunctionHelp("Return A x for a matrix, sparse handle, or operator handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[y = Ax\] column by column using the same products as MATRIX.SOLVE.ITER.</p>
+<p><b>Input:</b> A(m×n), x(n×p)</p>
+<p><b>Output:</b> y(m×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_operator_apply(_FP12* pa, _FP12* px)
+{
+#pragma XLLEXPORT
+    try {
+        std::unique_ptr<linear_operator> view;
+        const linear_operator* A = fp_operator(pa, view);
+        auto X = fp_map(px);
+
+        if (A->cols() != X.rows()) {
+            return nullptr;
+        }
+
+        _FP12* result = fp_alloc(A->rows(), X.cols());
+        auto Y = fp_out(result);
+        VectorXd y;
+        for (Index j = 0; j < X.cols(); ++j) {
+            A->apply(X.col(j), y);
+            Y.col(j) = y;
+        }
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
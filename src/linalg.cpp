@@ -5,7 +5,11 @@
 // Uses Eigen 5.0+ for high-performance linear algebra computations
 // ==============================================================================
 
+#include <cwctype>
 #include "linalg.h"
+#include "async.h"
+#include "cache.h"
+#include "tiny.h"
 
 // Suppress warnings from Eigen library headers (external code)
 #if defined(__GNUC__) && !defined(__clang__)
@@ -40,45 +44,333 @@ using namespace Eigen;
 // Helper Function Implementations
 // ==============================================================================
 
+fp_traffic& xll::linalg_traffic()
+{
+    static fp_traffic traffic;
+
+    return traffic;
+}
+
+Map<const RowMatrixXd> xll::fp_map(const _FP12* fp)
+{
+    // Excel stores in row-major order so the array can be used in place
+    linalg_traffic().read.fetch_add(sizeof(double) * xll::size(*fp), std::memory_order_relaxed);
+
+    return Map<const RowMatrixXd>(fp->array, fp->rows, fp->columns);
+}
+
+Map<const MatrixXd> xll::fp_map_transpose(const _FP12* fp)
+{
+    // Row-major A is column-major A^T
+    linalg_traffic().read.fetch_add(sizeof(double) * xll::size(*fp), std::memory_order_relaxed);
+
+    return Map<const MatrixXd>(fp->array, fp->columns, fp->rows);
+}
+
 MatrixXd xll::fp_to_eigen(const _FP12* fp)
 {
     // Excel stores in row-major order, Eigen defaults to column-major
-    // Use Map with RowMajor to avoid copy and transpose
-    return Map<const Matrix<double, Dynamic, Dynamic, RowMajor>>(
-        fp->array, fp->rows, fp->columns);
+    linalg_traffic().copied.fetch_add(sizeof(double) * xll::size(*fp), std::memory_order_relaxed);
+
+    return fp_map(fp);
 }
 
-_FP12* xll::eigen_to_fp(const MatrixXd& mat)
+MatrixXf xll::fp_to_float(const _FP12* fp)
 {
-    static FPX result;
-    result.resize(static_cast<int>(mat.rows()), static_cast<int>(mat.cols()));
-    Map<Matrix<double, Dynamic, Dynamic, RowMajor>>(
-        result.array(), mat.rows(), mat.cols()) = mat;
+    linalg_traffic().copied.fetch_add(sizeof(float) * xll::size(*fp), std::memory_order_relaxed);
+
+    return fp_map(fp).cast<float>();
+}
+
+_FP12* xll::fp_alloc(Index rows, Index cols)
+{
+    thread_local FPX result;
+    result.resize(static_cast<int>(rows), static_cast<int>(cols));
+    linalg_traffic().written.fetch_add(sizeof(double) * rows * cols, std::memory_order_relaxed);
+
     return result.get();
 }
 
-_FP12* xll::vector_to_fp(const VectorXd& vec)
+int xll::option(const OPER& o, std::initializer_list<const char*> names, int init)
 {
-    static FPX result;
-    result.resize(static_cast<int>(vec.size()), 1);
-    for (int i = 0; i < vec.size(); ++i) {
-        result(i, 0) = vec(i);
+    if (isNum(o)) {
+        return static_cast<int>(Num(o));
     }
-    return result.get();
+    if (isStr(o) && count(o) > 0) {
+        const auto s = view(o);
+        int i = 0;
+        for (const char* name : names) {
+            size_t k = 0;
+            while (name[k] && k < s.size() && std::towupper(s[k]) == static_cast<wint_t>(name[k])) {
+                ++k;
+            }
+            if (!name[k] && k == s.size()) {
+                return i;
+            }
+            ++i;
+        }
+
+        return -1;
+    }
+
+    return init;
+}
+
+Index xll::to_index(double n)
+{
+    ensure(n >= 0 && n < 0x1p31 && n == std::floor(n));
+
+    return static_cast<Index>(n);
 }
 
-_FP12* xll::row_vector_to_fp(const VectorXd& vec)
+Index xll::first_index(double i)
 {
-    static FPX result;
-    result.resize(1, static_cast<int>(vec.size()));
-    for (int i = 0; i < vec.size(); ++i) {
-        result(0, i) = vec(i);
+    const Index k = to_index(i);
+
+    return k ? k - 1 : 0;
+}
+
+// ==============================================================================
+// Structure Detection
+// ==============================================================================
+
+matrix_structure xll::probe_structure(const Eigen::Ref<const RowMatrixXd>& A)
+{
+    const Index n = A.rows();
+    matrix_structure s{ n, n - 1, n - 1, false };
+
+    ensure(A.cols() == n);
+
+    // Dense nonsymmetric matrices fail on the first read
+    if (n > 1 && A(n - 1, 0) != 0 && A(0, n - 1) != 0 && A(n - 1, 0) != A(0, n - 1)) {
+        return s;
     }
-    return result.get();
+
+    // Walk each row of the lower triangle toward the diagonal, pairing
+    // A(i,j) with A(j,i), so the widest band is found first
+    s.lower = 0;
+    s.upper = 0;
+    s.symmetric = true;
+    for (Index i = 1; i < n; ++i) {
+        for (Index j = 0; j < i; ++j) {
+            const double l = A(i, j);
+            const double u = A(j, i);
+            if (l != 0 && i - j > s.lower) {
+                s.lower = i - j;
+            }
+            if (u != 0 && i - j > s.upper) {
+                s.upper = i - j;
+            }
+            if (l != u) {
+                s.symmetric = false;
+            }
+        }
+        if (!s.symmetric && s.lower == n - 1 && s.upper == n - 1) {
+            break; // general
+        }
+    }
+
+    return s;
 }
 
+solver_paths& xll::linalg_paths()
+{
+    static solver_paths paths;
+
+    return paths;
+}
+
+bool matrix_structure::banded() const
+{
+    return size >= 32 && linalg_thresholds().band_ratio * (2 * lower + upper + 1) <= size;
+}
+
+kernel_thresholds& xll::linalg_thresholds()
+{
+    static kernel_thresholds thresholds;
+
+    return thresholds;
+}
+
+band_lu::band_lu(const Eigen::Ref<const RowMatrixXd>& A, Index kl_, Index ku_)
+    : n(A.rows()), kl(kl_), ku(ku_), ab(MatrixXd::Zero(2 * kl_ + ku_ + 1, A.rows())), ipiv(A.rows())
+{
+    for (Index j = 0; j < n; ++j) {
+        for (Index i = (std::max)(Index(0), j - ku); i <= (std::min)(n - 1, j + kl); ++i) {
+            at(i, j) = A(i, j);
+        }
+    }
+
+    Index ju = 0; // last column of U touched so far
+    for (Index j = 0; j < n; ++j) {
+        const Index km = (std::min)(kl, n - 1 - j);
+
+        Index p = 0;
+        for (Index i = 1; i <= km; ++i) {
+            if (std::fabs(at(j + i, j)) > std::fabs(at(j + p, j))) {
+                p = i;
+            }
+        }
+        ipiv[j] = j + p;
+        if (at(j + p, j) == 0) {
+            singular = true;
+            continue;
+        }
+
+        ju = (std::max)(ju, (std::min)(j + ku + p, n - 1));
+        if (p != 0) {
+            sign = -sign;
+            for (Index k = j; k <= ju; ++k) {
+                std::swap(at(j, k), at(j + p, k));
+            }
+        }
+
+        const double r = 1 / at(j, j);
+        for (Index i = 1; i <= km; ++i) {
+            at(j + i, j) *= r;
+        }
+        for (Index k = j + 1; k <= ju; ++k) {
+            const double u = at(j, k);
+            if (u != 0) {
+                for (Index i = 1; i <= km; ++i) {
+                    at(j + i, k) -= at(j + i, j) * u;
+                }
+            }
+        }
+    }
+}
+
+double band_lu::determinant() const
+{
+    return singular ? 0. : sign * ab.row(kl + ku).prod();
+}
+
+void band_lu::solve(MatrixXd& B) const
+{
+    // L: interchanges and multipliers in the order they were applied
+    for (Index j = 0; j < n; ++j) {
+        if (ipiv[j] != j) {
+            B.row(j).swap(B.row(ipiv[j]));
+        }
+        for (Index i = 1; i <= (std::min)(kl, n - 1 - j); ++i) {
+            B.row(j + i) -= at(j + i, j) * B.row(j);
+        }
+    }
+    // U: upper bandwidth kl + ku
+    for (Index j = n - 1; j >= 0; --j) {
+        B.row(j) /= at(j, j);
+        for (Index i = (std::max)(Index(0), j - kl - ku); i < j; ++i) {
+            B.row(i) -= at(i, j) * B.row(j);
+        }
+    }
+}
+
+namespace {
+
+    // Cholesky is only attempted when the diagonal is positive
+    bool positive_diagonal(const Eigen::Ref<const RowMatrixXd>& A)
+    {
+        return (A.diagonal().array() > 0).all();
+    }
+
+    // Estimate of ||A^-1||_1 from a few solves with A and A^T (Hager's method
+    // with Higham's refinements, as in LAPACK xLACON)
+    template<class Solve, class SolveTranspose>
+    double inverse_norm1(Index n, Solve&& solve, SolveTranspose&& solve_transpose)
+    {
+        VectorXd x = VectorXd::Constant(n, 1.0 / static_cast<double>(n));
+        double estimate = 0;
+        Index last = -1;
+        for (int k = 0; k < 5; ++k) {
+            const VectorXd y = solve(x);
+            estimate = (std::max)(estimate, y.lpNorm<1>());
+            const VectorXd z = solve_transpose(VectorXd(y.unaryExpr([](double v) { return v < 0 ? -1.0 : 1.0; })));
+            Index j;
+            const double zmax = z.cwiseAbs().maxCoeff(&j);
+            if (k > 0 && (zmax <= z.dot(x) || j == last)) {
+                break;
+            }
+            x.setZero();
+            x(j) = 1;
+            last = j;
+        }
+
+        // Alternating ramp guards against the iteration stalling on special matrices
+        VectorXd v(n);
+        for (Index i = 0; i < n; ++i) {
+            v(i) = (i % 2 ? -1 : 1) * (1 + static_cast<double>(i) / static_cast<double>((std::max<Index>)(n - 1, 1)));
+        }
+
+        const VectorXd w = solve(v);
+
+        return (std::max)(estimate, 2 * w.lpNorm<1>() / (3 * static_cast<double>(n)));
+    }
+
+    // Sign and log of the absolute value of the product of d
+    void log_product(const Eigen::Ref<const VectorXd>& d, double& sign, double& logabs)
+    {
+        for (Index i = 0; i < d.size(); ++i) {
+            sign *= d(i) > 0 ? 1 : d(i) < 0 ? -1 : 0;
+            logabs += std::log(std::abs(d(i)));
+        }
+    }
+
+    // {sign(det A), log|det A|, 1-norm reciprocal condition number} from one
+    // factorization: none for triangular A, Cholesky for SPD A, otherwise LU.
+    // MATRIX.LOGDET and MATRIX.RCOND share the cached result.
+    _FP12* determinant_summary(const _FP12* pa)
+    {
+        return cached(cache_id::logdet, pa, [&] {
+            const auto A = fp_map(pa);
+            ensure(A.rows() == A.cols() && A.rows() > 0);
+
+            const Index n = A.rows();
+            const auto s = probe_structure(A);
+            double sign = 1, logabs = 0, rcond = 0;
+
+            if (s.lower_triangular() || s.upper_triangular()) {
+                linalg_paths().take(s.diagonal() ? solver_path::diagonal : solver_path::triangular);
+                log_product(A.diagonal(), sign, logabs);
+                if (sign != 0) {
+                    const double norm = A.cwiseAbs().colwise().sum().maxCoeff();
+                    if (s.lower_triangular()) {
+                        const auto L = A.triangularView<Lower>();
+                        rcond = 1 / (norm * inverse_norm1(n,
+                            [&](const VectorXd& x) { return VectorXd(L.solve(x)); },
+                            [&](const VectorXd& x) { return VectorXd(L.transpose().solve(x)); }));
+                    }
+                    else {
+                        const auto U = A.triangularView<Upper>();
+                        rcond = 1 / (norm * inverse_norm1(n,
+                            [&](const VectorXd& x) { return VectorXd(U.solve(x)); },
+                            [&](const VectorXd& x) { return VectorXd(U.transpose().solve(x)); }));
+                    }
+                }
+            }
+            else if (LLT<MatrixXd> llt; s.symmetric && positive_diagonal(A)
+                && llt.compute(fp_map_transpose(pa)).info() == Success) {
+                linalg_paths().take(solver_path::cholesky);
+                log_product(llt.matrixLLT().diagonal(), sign, logabs);
+                logabs *= 2;
+                rcond = llt.rcond();
+            }
+            else {
+                linalg_paths().take(solver_path::general);
+                const PartialPivLU<MatrixXd> lu(A);
+                sign = lu.permutationP().determinant();
+                log_product(lu.matrixLU().diagonal(), sign, logabs);
+                rcond = sign != 0 ? lu.rcond() : 0;
+            }
+
+            const double summary[3] = { sign, logabs, rcond };
+            return row_vector_to_fp(Map<const VectorXd>(summary, 3));
+        });
+    }
+
+} // namespace
+
 // ==============================================================================
-// Basic Operations (8 functions)
+// Basic Operations (10 functions)
 // ==============================================================================
 
 // -----------------------------------------------------------------------------
@@ -90,6 +382,7 @@ AddIn xai_matrix_add(
         Arg(XLL_FP, "A", "is the first matrix."),
         Arg(XLL_FP, "B", "is the second matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Add two matrices element-wise.")
     .Category("LINALG")
     .Documentation(R"(
@@ -106,15 +399,14 @@ _FP12* WINAPI xll_matrix_add(_FP12* pa, _FP12* pb)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd B = fp_to_eigen(pb);
+        auto A = fp_map(pa);
+        auto B = fp_map(pb);
 
         if (A.rows() != B.rows() || A.cols() != B.cols()) {
             return nullptr; // Dimension mismatch
         }
 
-        MatrixXd C = A + B;
-        return eigen_to_fp(C);
+        return eigen_to_fp(A + B);
     }
     catch (...) {
         return nullptr;
@@ -130,6 +422,7 @@ AddIn xai_matrix_sub(
         Arg(XLL_FP, "A", "is the first matrix."),
         Arg(XLL_FP, "B", "is the second matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Subtract matrix B from A element-wise.")
     .Category("LINALG")
     .Documentation(R"(
@@ -146,15 +439,14 @@ _FP12* WINAPI xll_matrix_sub(_FP12* pa, _FP12* pb)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd B = fp_to_eigen(pb);
+        auto A = fp_map(pa);
+        auto B = fp_map(pb);
 
         if (A.rows() != B.rows() || A.cols() != B.cols()) {
             return nullptr;
         }
 
-        MatrixXd C = A - B;
-        return eigen_to_fp(C);
+        return eigen_to_fp(A - B);
     }
     catch (...) {
         return nullptr;
@@ -170,6 +462,7 @@ AddIn xai_matrix_mul(
         Arg(XLL_FP, "A", "is the first matrix."),
         Arg(XLL_FP, "B", "is the second matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Multiply matrices A and B.")
     .Category("LINALG")
     .Documentation(R"(
@@ -187,15 +480,26 @@ _FP12* WINAPI xll_matrix_mul(_FP12* pa, _FP12* pb)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd B = fp_to_eigen(pb);
+        auto A = fp_map(pa);
+        auto B = fp_map(pb);
 
         if (A.cols() != B.rows()) {
             return nullptr; // Dimension mismatch
         }
 
-        MatrixXd C = A * B;
-        return eigen_to_fp(C);
+        // Row-major GEMM evaluated straight into the result buffer
+        _FP12* C = fp_alloc(A.rows(), B.cols());
+        auto C_ = fp_out(C);
+        if (A.rows() * A.cols() * B.cols() < linalg_thresholds().gemm_parallel) {
+            C_.noalias() = A * B;
+        }
+        else {
+            // Row blocks of C are independent and contiguous
+            parallel_for(A.rows(), 16, [&](Index i, Index j) {
+                C_.middleRows(i, j - i).noalias() = A.middleRows(i, j - i) * B;
+            });
+        }
+        return C;
     }
     catch (...) {
         return nullptr;
@@ -210,6 +514,7 @@ AddIn xai_matrix_transpose(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix to transpose.")
     })
+    .ThreadSafe()
     .FunctionHelp("Transpose a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -226,9 +531,8 @@ _FP12* WINAPI xll_matrix_transpose(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd At = A.transpose();
-        return eigen_to_fp(At);
+        // Column-major view of A^T has the row-major layout of A
+        return eigen_to_fp(fp_map(pa).transpose());
     }
     catch (...) {
         return nullptr;
@@ -243,6 +547,7 @@ AddIn xai_matrix_trace(
     .Arguments({
         Arg(XLL_FP, "A", "is a square matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute the trace of a square matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -259,7 +564,7 @@ double WINAPI xll_matrix_trace(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         if (A.rows() != A.cols()) {
             return std::numeric_limits<double>::quiet_NaN(); // Not square
@@ -280,6 +585,7 @@ AddIn xai_matrix_norm(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute the Frobenius norm of a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -296,8 +602,7 @@ double WINAPI xll_matrix_norm(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        return A.norm();
+        return fp_map(pa).norm();
     }
     catch (...) {
         return std::numeric_limits<double>::quiet_NaN();
@@ -312,6 +617,7 @@ AddIn xai_matrix_det(
     .Arguments({
         Arg(XLL_FP, "A", "is a square matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute the determinant of a square matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -328,13 +634,43 @@ double WINAPI xll_matrix_det(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        // det(A^T) = det(A) and A^T is column-major in place
+        auto At = fp_map_transpose(pa);
 
-        if (A.rows() != A.cols()) {
+        if (At.rows() != At.cols()) {
             return std::numeric_limits<double>::quiet_NaN(); // Not square
         }
 
-        return A.determinant();
+        double det;
+        if (tiny_dispatch(At.rows(), [&](auto N) { det = tiny_determinant<N>(fp_map(pa)); })) {
+            linalg_paths().take(solver_path::fixed);
+            return det;
+        }
+
+        return cached(cache_id::det, pa, [&] {
+            const auto A = fp_map(pa);
+            const auto s = probe_structure(A);
+
+            if (s.lower_triangular() || s.upper_triangular()) {
+                linalg_paths().take(s.diagonal() ? solver_path::diagonal : solver_path::triangular);
+                return A.diagonal().prod();
+            }
+            if (s.banded()) {
+                linalg_paths().take(solver_path::banded);
+                return band_lu(A, s.lower, s.upper).determinant();
+            }
+            if (s.symmetric && positive_diagonal(A)) {
+                LLT<MatrixXd> llt(At);
+                if (llt.info() == Success) {
+                    linalg_paths().take(solver_path::cholesky);
+                    const double d = llt.matrixLLT().diagonal().prod();
+                    return d * d;
+                }
+            }
+
+            linalg_paths().take(solver_path::general);
+            return At.determinant();
+        });
     }
     catch (...) {
         return std::numeric_limits<double>::quiet_NaN();
@@ -349,6 +685,7 @@ AddIn xai_matrix_rank(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute the rank of a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -365,9 +702,100 @@ double WINAPI xll_matrix_rank(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        FullPivLU<MatrixXd> lu(A);
-        return static_cast<double>(lu.rank());
+        return cached(cache_id::rank, pa, [&] {
+            if (pa->rows == pa->columns) {
+                const auto A = fp_map(pa);
+                if (probe_structure(A).diagonal()) {
+                    // Same threshold as FullPivLU
+                    linalg_paths().take(solver_path::diagonal);
+                    const VectorXd d = A.diagonal().cwiseAbs();
+                    const double threshold = std::numeric_limits<double>::epsilon() * d.size() * d.maxCoeff();
+                    return static_cast<double>((d.array() > threshold).count());
+                }
+            }
+
+            // rank(A^T) = rank(A)
+            linalg_paths().take(solver_path::general);
+            FullPivLU<MatrixXd> lu(fp_map_transpose(pa));
+            return static_cast<double>(lu.rank());
+        });
+    }
+    catch (...) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.LOGDET - Sign and log absolute determinant
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_logdet(
+    Function(XLL_FP, "xll_matrix_logdet", "MATRIX.LOGDET")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the sign and log absolute determinant of a square matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes s and l with \[\det(A) = s\,e^l\] by summing the logs of the
+diagonal of the cheapest applicable factorization: none for triangular A,
+Cholesky for symmetric positive-definite A, and LU with partial pivoting
+otherwise. Unlike MATRIX.DETERMINANT it does not overflow or underflow for
+large n.</p>
+<p><b>Input:</b> Square matrix A(n×n)</p>
+<p><b>Output:</b> Row vector {sign, log|det(A)|} (1×2). A singular matrix has
+sign 0 and log|det(A)| #NUM!.</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_logdet(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        const _FP12* summary = determinant_summary(pa);
+        const double result[2] = { summary->array[0], summary->array[1] };
+
+        return row_vector_to_fp(Map<const VectorXd>(result, 2));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.RCOND - Reciprocal condition number estimate
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_rcond(
+    Function(XLL_DOUBLE, "xll_matrix_rcond", "MATRIX.RCOND")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Estimate the reciprocal 1-norm condition number of a square matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Estimates \[1 / (\|A\|_1 \|A^{-1}\|_1)\] as LAPACK xGECON does, from a few
+O(n²) solves with the factorization used by MATRIX.LOGDET instead of forming
+the inverse. Values near machine epsilon (about 1e-16) mean A is numerically
+singular. The estimate of \[\|A^{-1}\|_1\] is a lower bound, so the result is
+never smaller than the true reciprocal condition number and can overstate how
+well conditioned A is, usually by at most a small factor.</p>
+<p><b>Input:</b> Square matrix A(n×n)</p>
+<p><b>Output:</b> Scalar in [0, 1]</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+double WINAPI xll_matrix_rcond(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        return determinant_summary(pa)->array[2];
     }
     catch (...) {
         return std::numeric_limits<double>::quiet_NaN();
@@ -386,6 +814,7 @@ AddIn xai_matrix_inv(
     .Arguments({
         Arg(XLL_FP, "A", "is a square invertible matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute the inverse of a square matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -402,14 +831,23 @@ _FP12* WINAPI xll_matrix_inv(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         if (A.rows() != A.cols()) {
             return nullptr; // Not square
         }
 
-        MatrixXd Ainv = A.inverse();
-        return eigen_to_fp(Ainv);
+        _FP12* result;
+        if (tiny_dispatch(A.rows(), [&](auto N) { result = tiny_inverse<N>(A); })) {
+            linalg_paths().take(solver_path::fixed);
+            return result;
+        }
+
+        return cached(cache_id::inverse, pa, [&] {
+            // Row-major LU, inverse evaluated into the result buffer
+            PartialPivLU<RowMatrixXd> lu(A);
+            return eigen_to_fp(lu.inverse());
+        });
     }
     catch (...) {
         return nullptr;
@@ -424,6 +862,7 @@ AddIn xai_matrix_lu(
     .Arguments({
         Arg(XLL_FP, "A", "is a square matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute LU decomposition of a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -441,20 +880,17 @@ _FP12* WINAPI xll_matrix_lu(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         if (A.rows() != A.cols()) {
             return nullptr;
         }
 
-        PartialPivLU<MatrixXd> lu(A);
-        MatrixXd L = MatrixXd::Identity(A.rows(), A.cols());
-        L.triangularView<StrictlyLower>() = lu.matrixLU();
-        MatrixXd U = lu.matrixLU().triangularView<Upper>();
-
-        // Return combined (L below diagonal + U on and above diagonal)
-        MatrixXd LU = lu.matrixLU();
-        return eigen_to_fp(LU);
+        return cached(cache_id::lu, pa, [&] {
+            // Return combined (L below diagonal + U on and above diagonal)
+            PartialPivLU<RowMatrixXd> lu(A);
+            return eigen_to_fp(lu.matrixLU());
+        });
     }
     catch (...) {
         return nullptr;
@@ -469,6 +905,7 @@ AddIn xai_matrix_qr(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute QR decomposition of a matrix (returns R).")
     .Category("LINALG")
     .Documentation(R"(
@@ -486,10 +923,11 @@ _FP12* WINAPI xll_matrix_qr(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        HouseholderQR<MatrixXd> qr(A);
-        MatrixXd R = qr.matrixQR().triangularView<Upper>();
-        return eigen_to_fp(R);
+        return cached(cache_id::qr, pa, [&] {
+            // Householder reflections work on columns so factor column-major
+            HouseholderQR<MatrixXd> qr(fp_map(pa));
+            return eigen_to_fp(qr.matrixQR().triangularView<Upper>());
+        });
     }
     catch (...) {
         return nullptr;
@@ -504,6 +942,7 @@ AddIn xai_matrix_cholesky(
     .Arguments({
         Arg(XLL_FP, "A", "is a symmetric positive-definite matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute Cholesky decomposition of a SPD matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -521,19 +960,26 @@ _FP12* WINAPI xll_matrix_cholesky(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         if (A.rows() != A.cols()) {
             return nullptr;
         }
 
-        LLT<MatrixXd> llt(A);
-        if (llt.info() != Success) {
-            return nullptr; // Not positive definite
+        _FP12* result;
+        if (tiny_dispatch(A.rows(), [&](auto N) { result = tiny_cholesky<N>(A); })) {
+            linalg_paths().take(solver_path::fixed);
+            return result;
         }
 
-        MatrixXd L = llt.matrixL();
-        return eigen_to_fp(L);
+        return cached(cache_id::cholesky, pa, [&]() -> _FP12* {
+            LLT<RowMatrixXd> llt(A);
+            if (llt.info() != Success) {
+                return nullptr; // Not positive definite
+            }
+
+            return eigen_to_fp(llt.matrixL());
+        });
     }
     catch (...) {
         return nullptr;
@@ -548,6 +994,7 @@ AddIn xai_matrix_svd(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute singular values of a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -565,10 +1012,16 @@ _FP12* WINAPI xll_matrix_svd(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        JacobiSVD<MatrixXd> svd(A);
-        VectorXd sigma = svd.singularValues();
-        return vector_to_fp(sigma);
+        return cached(cache_id::svd, pa, [&] {
+            // A and A^T have the same singular values
+            if ((std::min)(pa->rows, pa->columns) >= linalg_thresholds().svd_divide_conquer) {
+                BDCSVD<MatrixXd> svd(fp_map_transpose(pa));
+                return vector_to_fp(svd.singularValues());
+            }
+
+            JacobiSVD<MatrixXd> svd(fp_map_transpose(pa));
+            return vector_to_fp(svd.singularValues());
+        });
     }
     catch (...) {
         return nullptr;
@@ -583,6 +1036,7 @@ AddIn xai_matrix_svd_full(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute full SVD decomposition with all components stacked.")
     .Category("LINALG")
     .Documentation(R"(
@@ -601,61 +1055,38 @@ _FP12* WINAPI xll_matrix_svd_full(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-
-        // Compute thin SVD
-        JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
-
-        MatrixXd U = svd.matrixU();          // m × k
-        VectorXd sigma = svd.singularValues(); // k × 1
-        MatrixXd V = svd.matrixV();          // n × k
-        MatrixXd Vt = V.transpose();         // k × n
-
-        int m = static_cast<int>(A.rows());
-        int n = static_cast<int>(A.cols());
-        int k = static_cast<int>(sigma.size()); // min(m,n)
-
-        // Create Σ as diagonal matrix (k×k)
-        MatrixXd Sigma = sigma.asDiagonal();
-
-        // Determine max width needed
-        int max_cols = (std::max)(m, n);
-        max_cols = (std::max)(max_cols, k);
-
-        // Total rows: m (U) + k (Σ) + k (V^T)
-        int total_rows = m + k + k;
-
-        // Create result matrix with zero padding
-        static FPX result;
-        result.resize(total_rows, max_cols);
-
-        // Initialize to zero
-        for (int i = 0; i < total_rows * max_cols; ++i) {
-            result[i] = 0.0;
-        }
-
-        // Copy U (m×k) to top section
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < k; ++j) {
-                result(i, j) = U(i, j);
-            }
-        }
-
-        // Copy Σ (k×k) to middle section
-        for (int i = 0; i < k; ++i) {
-            for (int j = 0; j < k; ++j) {
-                result(m + i, j) = Sigma(i, j);
-            }
-        }
-
-        // Copy V^T (k×n) to bottom section
-        for (int i = 0; i < k; ++i) {
-            for (int j = 0; j < n; ++j) {
-                result(m + k + i, j) = Vt(i, j);
+        return cached(cache_id::svd_full, pa, [&] {
+            // SVD of A^T = V Σ U^T gives U and V with the roles swapped
+            auto At = fp_map_transpose(pa);
+            const auto stack = [&](const auto& svd) {
+                int m = static_cast<int>(At.cols());
+                int n = static_cast<int>(At.rows());
+                int k = static_cast<int>(svd.singularValues().size()); // min(m,n)
+
+                // Determine max width needed
+                int max_cols = (std::max)(m, n);
+                max_cols = (std::max)(max_cols, k);
+
+                // Total rows: m (U) + k (Σ) + k (V^T)
+                int total_rows = m + k + k;
+
+                // Create result matrix with zero padding
+                _FP12* result = fp_alloc(total_rows, max_cols);
+                auto R = fp_out(result);
+                R.setZero();
+
+                R.block(0, 0, m, k) = svd.matrixV();                          // U (m×k)
+                R.block(m, 0, k, k).diagonal() = svd.singularValues();       // Σ (k×k)
+                R.block(m + k, 0, k, n) = svd.matrixU().transpose();         // V^T (k×n)
+
+                return result;
+            };
+
+            if ((std::min)(At.rows(), At.cols()) >= linalg_thresholds().svd_divide_conquer) {
+                return stack(BDCSVD<MatrixXd, ComputeThinU | ComputeThinV>(At));
             }
-        }
-
-        return result.get();
+            return stack(JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV>(At));
+        });
     }
     catch (...) {
         return nullptr;
@@ -670,11 +1101,14 @@ AddIn xai_matrix_eigenvalues(
     .Arguments({
         Arg(XLL_FP, "A", "is a square matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute eigenvalues of a square matrix.")
     .Category("LINALG")
     .Documentation(R"(
 <p>Computes eigenvalues satisfying: \[Av = \lambda v\]</p>
 <p>Returns real parts of eigenvalues (imaginary parts ignored).</p>
+<p>Triangular matrices return the diagonal and symmetric matrices use the
+symmetric eigensolver, which returns eigenvalues in increasing order.</p>
 <p><b>Input:</b> Square matrix A(n×n)</p>
 <p><b>Output:</b> Column vector of eigenvalues (n×1)</p>
 )")
@@ -687,15 +1121,32 @@ _FP12* WINAPI xll_matrix_eigenvalues(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        // A and A^T have the same eigenvalues
+        auto At = fp_map_transpose(pa);
 
-        if (A.rows() != A.cols()) {
+        if (At.rows() != At.cols()) {
             return nullptr;
         }
 
-        EigenSolver<MatrixXd> es(A);
-        VectorXd eigenvalues = es.eigenvalues().real();
-        return vector_to_fp(eigenvalues);
+        return cached(cache_id::eigenvalues, pa, [&] {
+            const auto A = fp_map(pa);
+            const auto s = probe_structure(A);
+
+            if (s.lower_triangular() || s.upper_triangular()) {
+                linalg_paths().take(s.diagonal() ? solver_path::diagonal : solver_path::triangular);
+                return vector_to_fp(A.diagonal());
+            }
+            if (s.symmetric) {
+                // Real eigenvalues in increasing order
+                linalg_paths().take(solver_path::selfadjoint);
+                SelfAdjointEigenSolver<MatrixXd> es(At, EigenvaluesOnly);
+                return vector_to_fp(es.eigenvalues());
+            }
+
+            linalg_paths().take(solver_path::general);
+            EigenSolver<MatrixXd> es(At, false); // skip eigenvectors
+            return vector_to_fp(es.eigenvalues().real());
+        });
     }
     catch (...) {
         return nullptr;
@@ -710,6 +1161,7 @@ AddIn xai_matrix_eigenvectors(
     .Arguments({
         Arg(XLL_FP, "A", "is a square matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute eigenvectors of a square matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -727,15 +1179,30 @@ _FP12* WINAPI xll_matrix_eigenvectors(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         if (A.rows() != A.cols()) {
             return nullptr;
         }
 
-        EigenSolver<MatrixXd> es(A);
-        MatrixXd eigenvectors = es.eigenvectors().real();
-        return eigen_to_fp(eigenvectors);
+        return cached(cache_id::eigenvectors, pa, [&] {
+            const auto s = probe_structure(A);
+
+            if (s.diagonal()) {
+                linalg_paths().take(solver_path::diagonal);
+                return eigen_to_fp(MatrixXd::Identity(A.rows(), A.cols()));
+            }
+            if (s.symmetric) {
+                // Orthonormal eigenvectors in the order of MATRIX.EIGENVALUES
+                linalg_paths().take(solver_path::selfadjoint);
+                SelfAdjointEigenSolver<MatrixXd> es(A);
+                return eigen_to_fp(es.eigenvectors());
+            }
+
+            linalg_paths().take(solver_path::general);
+            EigenSolver<MatrixXd> es(A);
+            return eigen_to_fp(es.eigenvectors().real());
+        });
     }
     catch (...) {
         return nullptr;
@@ -743,7 +1210,7 @@ _FP12* WINAPI xll_matrix_eigenvectors(_FP12* pa)
 }
 
 // ==============================================================================
-// Linear Solvers (3 functions)
+// Linear Solvers (4 functions)
 // ==============================================================================
 
 // -----------------------------------------------------------------------------
@@ -755,10 +1222,14 @@ AddIn xai_matrix_solve(
         Arg(XLL_FP, "A", "is a square coefficient matrix."),
         Arg(XLL_FP, "b", "is the right-hand side vector or matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Solve linear system Ax = b.")
     .Category("LINALG")
     .Documentation(R"(
 <p>Solves linear system: \[Ax = b\]</p>
+<p>Diagonal and triangular A are solved by substitution, narrow banded A by band
+LU, and symmetric positive-definite A by Cholesky. Other A use LU with partial
+pivoting. See MATRIX.SOLVER.PATHS.</p>
 <p><b>Input:</b> A(n×n) coefficient matrix, b(n×1) or b(n×m) right-hand side</p>
 <p><b>Output:</b> Solution x(n×1) or x(n×m)</p>
 )")
@@ -771,15 +1242,57 @@ _FP12* WINAPI xll_matrix_solve(_FP12* pa, _FP12* pb)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd b = fp_to_eigen(pb);
+        // Factor A^T column-major in place and solve with the transposed factors
+        auto At = fp_map_transpose(pa);
+        auto b = fp_map(pb);
 
-        if (A.rows() != A.cols() || A.rows() != b.rows()) {
+        if (At.rows() != At.cols() || At.cols() != b.rows()) {
             return nullptr;
         }
 
-        MatrixXd x = A.lu().solve(b);
-        return eigen_to_fp(x);
+        _FP12* result;
+        if (tiny_dispatch(At.rows(), [&](auto N) { result = tiny_solve<N>(fp_map(pa), b); })) {
+            linalg_paths().take(solver_path::fixed);
+            return result;
+        }
+
+        return cached(cache_id::solve, pa, pb, [&] {
+            const auto A = fp_map(pa);
+            const auto s = probe_structure(A);
+
+            if (s.diagonal()) {
+                linalg_paths().take(solver_path::diagonal);
+                return eigen_to_fp(A.diagonal().cwiseInverse().asDiagonal() * b);
+            }
+            if (s.lower_triangular()) {
+                linalg_paths().take(solver_path::triangular);
+                return eigen_to_fp(A.triangularView<Lower>().solve(b));
+            }
+            if (s.upper_triangular()) {
+                linalg_paths().take(solver_path::triangular);
+                return eigen_to_fp(A.triangularView<Upper>().solve(b));
+            }
+            if (s.banded()) {
+                band_lu lu(A, s.lower, s.upper);
+                if (lu.invertible()) {
+                    linalg_paths().take(solver_path::banded);
+                    MatrixXd x = b;
+                    lu.solve(x);
+                    return eigen_to_fp(x);
+                }
+            }
+            if (s.symmetric && positive_diagonal(A)) {
+                LLT<MatrixXd> llt(At);
+                if (llt.info() == Success) {
+                    linalg_paths().take(solver_path::cholesky);
+                    return eigen_to_fp(llt.solve(b));
+                }
+            }
+
+            linalg_paths().take(solver_path::general);
+            PartialPivLU<MatrixXd> lu(At);
+            return eigen_to_fp(lu.transpose().solve(b));
+        });
     }
     catch (...) {
         return nullptr;
@@ -795,6 +1308,7 @@ AddIn xai_matrix_lstsq(
         Arg(XLL_FP, "A", "is the coefficient matrix."),
         Arg(XLL_FP, "b", "is the right-hand side vector.")
     })
+    .ThreadSafe()
     .FunctionHelp("Solve overdetermined system in least squares sense.")
     .Category("LINALG")
     .Documentation(R"(
@@ -811,17 +1325,138 @@ _FP12* WINAPI xll_matrix_lstsq(_FP12* pa, _FP12* pb)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-        MatrixXd b = fp_to_eigen(pb);
+        auto A = fp_map(pa);
+        auto b = fp_map(pb);
 
         if (A.rows() != b.rows()) {
             return nullptr;
         }
 
-        // Use SVD for robust least squares
-        BDCSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
-        MatrixXd x = svd.solve(b);
-        return eigen_to_fp(x);
+        return cached(cache_id::lstsq, pa, pb, [&] {
+            // Use SVD for robust least squares
+            if ((std::min)(A.rows(), A.cols()) >= linalg_thresholds().svd_divide_conquer) {
+                BDCSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
+                return eigen_to_fp(svd.solve(b));
+            }
+
+            JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
+            return eigen_to_fp(svd.solve(b));
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SOLVE.REFINE - Mixed-precision iterative refinement
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_solve_refine(
+    Function(XLL_FP, "xll_matrix_solve_refine", "MATRIX.SOLVE.REFINE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square coefficient matrix."),
+        Arg(XLL_FP, "b", "is the right-hand side vector or matrix."),
+        Arg(XLL_DOUBLE, "maxiter", "is the optional maximum number of refinement steps up to 1000. Default is 30.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Solve linear system Ax = b with a float factorization refined to double accuracy.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves linear system \[Ax = b\] by factoring A once in single precision and
+iterating \[r = b - Ax,\quad x \leftarrow x + A^{-1}r\] with residuals computed in
+double precision until \[\|r\|_\infty \le \|x\|_\infty \|A\|_\infty \epsilon \sqrt{n}\]</p>
+<p>The O(n³) factorization runs at float speed and the O(n²) steps recover
+double accuracy when the condition number of A is well below 10^8. Columns that
+do not converge are solved with a double-precision LU and report -1 iterations.</p>
+<p><b>Input:</b> A(n×n) coefficient matrix, b(n×p) right-hand side</p>
+<p><b>Output:</b> Solution x(n×p) followed by a row of refinement steps and a row
+with the estimated condition number κ₁(A) ((n+2)×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_solve_refine(_FP12* pa, _FP12* pb, double maxiter)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+        auto b = fp_map(pb);
+
+        if (A.rows() != A.cols() || A.cols() != b.rows()) {
+            return nullptr;
+        }
+        // 0 selects the default. Converged columns stop long before the cap.
+        ensure(maxiter >= 0 && maxiter == std::floor(maxiter));
+        const int steps = maxiter ? static_cast<int>((std::min)(maxiter, 1000.)) : 30;
+
+        const auto refine = [&] {
+            const Index n = A.rows();
+            const Index p = b.cols();
+
+            PartialPivLU<MatrixXf> lu(fp_to_float(pa));
+            double cond = 1 / static_cast<double>(lu.rcond());
+
+            // Stopping criterion of LAPACK dsgesv
+            const double anorm = A.cwiseAbs().rowwise().sum().maxCoeff();
+            const double bound = anorm * std::numeric_limits<double>::epsilon() * std::sqrt(static_cast<double>(n));
+
+            MatrixXd x = lu.solve(b.cast<float>()).cast<double>();
+            RowVectorXd iterations = RowVectorXd::Constant(p, -1);
+            MatrixXd r(n, p);
+            for (int k = 0; k <= steps; ++k) {
+                r.noalias() = b - A * x;
+
+                bool done = true;
+                for (Index j = 0; j < p; ++j) {
+                    if (iterations(j) < 0) {
+                        if (r.col(j).lpNorm<Infinity>() <= x.col(j).lpNorm<Infinity>() * bound) {
+                            iterations(j) = k;
+                        }
+                        else {
+                            done = false;
+                        }
+                    }
+                }
+                if (done || k == steps) {
+                    break;
+                }
+
+                // Scale residuals so they do not underflow in float
+                for (Index j = 0; j < p; ++j) {
+                    if (iterations(j) < 0) {
+                        const double scale = r.col(j).lpNorm<Infinity>();
+                        const VectorXf dx = lu.solve((r.col(j) / scale).cast<float>());
+                        x.col(j) += scale * dx.cast<double>();
+                    }
+                }
+            }
+
+            // Refinement stagnates when A is too ill-conditioned for float
+            if ((iterations.array() < 0).any()) {
+                PartialPivLU<MatrixXd> lu64(A);
+                cond = 1 / lu64.rcond();
+                for (Index j = 0; j < p; ++j) {
+                    if (iterations(j) < 0) {
+                        x.col(j) = lu64.solve(b.col(j));
+                    }
+                }
+            }
+
+            _FP12* result = fp_alloc(n + 2, p);
+            auto R = fp_out(result);
+            R.topRows(n) = x;
+            R.row(n) = iterations;
+            R.row(n + 1).setConstant(cond);
+
+            return result;
+        };
+
+        // The number of steps is part of the key
+        return cacheable(pa, pb)
+            ? memoize(cache_key(cache_id::solve_refine, pa, pb) + static_cast<uint64_t>(steps), pa, pb, refine)
+            : refine();
     }
     catch (...) {
         return nullptr;
@@ -836,6 +1471,7 @@ AddIn xai_matrix_pinv(
     .Arguments({
         Arg(XLL_FP, "A", "is the matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Compute Moore-Penrose pseudoinverse of a matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -853,32 +1489,39 @@ _FP12* WINAPI xll_matrix_pinv(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
-
-        // Compute pseudoinverse using SVD
-        JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
-
-        // Tolerance for singular values
-        auto max_dim = (std::max)(A.rows(), A.cols());
-        double tolerance = std::numeric_limits<double>::epsilon() *
-                          max_dim *
-                          svd.singularValues().array().abs().maxCoeff();
-
-        // Compute pseudoinverse
-        VectorXd singularValuesInv(svd.singularValues().size());
-        for (int i = 0; i < svd.singularValues().size(); ++i) {
-            if (svd.singularValues()(i) > tolerance) {
-                singularValuesInv(i) = 1.0 / svd.singularValues()(i);
-            } else {
-                singularValuesInv(i) = 0.0;
+        return cached(cache_id::pinv, pa, [&] {
+            // SVD of A^T = V Σ U^T so A^+ = U' Σ^+ V'^T with U' = V, V' = U
+            auto At = fp_map_transpose(pa);
+            const auto invert = [&](const auto& svd) {
+                // Tolerance for singular values
+                auto max_dim = (std::max)(At.rows(), At.cols());
+                double tolerance = std::numeric_limits<double>::epsilon() *
+                                  max_dim *
+                                  svd.singularValues().array().abs().maxCoeff();
+
+                // Compute pseudoinverse
+                VectorXd singularValuesInv(svd.singularValues().size());
+                for (int i = 0; i < svd.singularValues().size(); ++i) {
+                    if (svd.singularValues()(i) > tolerance) {
+                        singularValuesInv(i) = 1.0 / svd.singularValues()(i);
+                    } else {
+                        singularValuesInv(i) = 0.0;
+                    }
+                }
+
+                _FP12* Ainv = fp_alloc(At.rows(), At.cols());
+                fp_out(Ainv).noalias() = svd.matrixU() *
+                                         singularValuesInv.asDiagonal() *
+                                         svd.matrixV().adjoint();
+
+                return Ainv;
+            };
+
+            if ((std::min)(At.rows(), At.cols()) >= linalg_thresholds().svd_divide_conquer) {
+                return invert(BDCSVD<MatrixXd, ComputeThinU | ComputeThinV>(At));
             }
-        }
-
-        MatrixXd Ainv = svd.matrixV() *
-                       singularValuesInv.asDiagonal() *
-                       svd.matrixU().adjoint();
-
-        return eigen_to_fp(Ainv);
+            return invert(JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV>(At));
+        });
     }
     catch (...) {
         return nullptr;
@@ -886,7 +1529,7 @@ _FP12* WINAPI xll_matrix_pinv(_FP12* pa)
 }
 
 // ==============================================================================
-// Utility Functions (3 functions)
+// Utility Functions (5 functions)
 // ==============================================================================
 
 // -----------------------------------------------------------------------------
@@ -897,6 +1540,7 @@ AddIn xai_matrix_identity(
     .Arguments({
         Arg(XLL_DOUBLE, "n", "is the dimension of the identity matrix.")
     })
+    .ThreadSafe()
     .FunctionHelp("Create an n×n identity matrix.")
     .Category("LINALG")
     .Documentation(R"(
@@ -919,8 +1563,7 @@ _FP12* WINAPI xll_matrix_identity(double n)
             return nullptr; // Invalid dimension
         }
 
-        MatrixXd I = MatrixXd::Identity(dim, dim);
-        return eigen_to_fp(I);
+        return eigen_to_fp(MatrixXd::Identity(dim, dim));
     }
     catch (...) {
         return nullptr;
@@ -936,6 +1579,7 @@ AddIn xai_matrix_zeros(
         Arg(XLL_DOUBLE, "m", "is the number of rows."),
         Arg(XLL_DOUBLE, "n", "is the number of columns.")
     })
+    .ThreadSafe()
     .FunctionHelp("Create an m×n matrix of zeros.")
     .Category("LINALG")
     .Documentation(R"(
@@ -959,8 +1603,7 @@ _FP12* WINAPI xll_matrix_zeros(double m, double n)
             return nullptr;
         }
 
-        MatrixXd Z = MatrixXd::Zero(rows, cols);
-        return eigen_to_fp(Z);
+        return eigen_to_fp(MatrixXd::Zero(rows, cols));
     }
     catch (...) {
         return nullptr;
@@ -975,6 +1618,7 @@ AddIn xai_matrix_diag(
     .Arguments({
         Arg(XLL_FP, "A", "is a matrix or vector.")
     })
+    .ThreadSafe()
     .FunctionHelp("Extract diagonal from matrix or create diagonal matrix from vector.")
     .Category("LINALG")
     .Documentation(R"(
@@ -992,19 +1636,115 @@ _FP12* WINAPI xll_matrix_diag(_FP12* pa)
 {
 #pragma XLLEXPORT
     try {
-        MatrixXd A = fp_to_eigen(pa);
+        auto A = fp_map(pa);
 
         // If vector (1 column), create diagonal matrix
         if (A.cols() == 1) {
-            VectorXd v = A.col(0);
-            MatrixXd D = v.asDiagonal();
-            return eigen_to_fp(D);
+            _FP12* D = fp_alloc(A.rows(), A.rows());
+            fp_out(D) = A.col(0).asDiagonal();
+            return D;
         }
         // If matrix, extract diagonal
         else {
-            VectorXd d = A.diagonal();
-            return vector_to_fp(d);
+            return vector_to_fp(A.diagonal());
+        }
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.TRAFFIC - Bytes moved between Excel buffers and LINALG kernels
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_traffic(
+    Function(XLL_FP, "xll_matrix_traffic", "MATRIX.TRAFFIC")
+    .Arguments({
+        Arg(XLL_LPOPER, "reset", "is an optional boolean to reset the counters after reading them.")
+    })
+    .ThreadSafe()
+    .Volatile()
+    .FunctionHelp("Return bytes read, written, and copied by LINALG functions.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns the memory traffic counters of the LINALG functions as a row.</p>
+<p><b>read</b>: bytes of FP12 arguments used in place by the kernels</p>
+<p><b>written</b>: bytes evaluated directly into FP12 results</p>
+<p><b>copied</b>: bytes staged through intermediate Eigen matrices</p>
+<p><b>Output:</b> Row vector {read, written, copied} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_traffic(LPOPER preset)
+{
+#pragma XLLEXPORT
+    try {
+        auto& traffic = linalg_traffic();
+        double counters[3] = {
+            static_cast<double>(traffic.read.load()),
+            static_cast<double>(traffic.written.load()),
+            static_cast<double>(traffic.copied.load())
+        };
+        if (*preset) {
+            traffic.reset();
         }
+
+        return row_vector_to_fp(Map<const VectorXd>(counters, 3));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SOLVER.PATHS - Structure-specific kernel counters
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_solver_paths(
+    Function(XLL_FP, "xll_matrix_solver_paths", "MATRIX.SOLVER.PATHS")
+    .Arguments({
+        Arg(XLL_LPOPER, "reset", "is an optional boolean to reset the counters after reading them.")
+    })
+    .ThreadSafe()
+    .Volatile()
+    .FunctionHelp("Return how often each structure-specific kernel was used.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>MATRIX.SOLVE, MATRIX.DETERMINANT, MATRIX.RANK, MATRIX.EIGENVALUES and
+MATRIX.EIGENVECTORS scan a square argument for zero bands and symmetry before
+choosing a kernel. Cached results are not counted.</p>
+<p><b>general</b>: LU or the nonsymmetric eigensolver</p>
+<p><b>diagonal</b>: elementwise operations on the diagonal</p>
+<p><b>triangular</b>: substitution or the diagonal of a triangular matrix</p>
+<p><b>cholesky</b>: LLT of a symmetric positive-definite matrix</p>
+<p><b>banded</b>: band LU with partial pivoting</p>
+<p><b>selfadjoint</b>: symmetric eigensolver</p>
+<p><b>fixed</b>: stack-allocated 2×2 to 6×6 kernels of MATRIX.INVERSE, MATRIX.DETERMINANT,
+MATRIX.SOLVE and MATRIX.CHOLESKY</p>
+<p><b>Output:</b> Row vector {general, diagonal, triangular, cholesky, banded, selfadjoint, fixed} (1×7)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_solver_paths(LPOPER preset)
+{
+#pragma XLLEXPORT
+    try {
+        auto& paths = linalg_paths();
+        constexpr int n = static_cast<int>(solver_path::count);
+        double counters[n];
+        for (int i = 0; i < n; ++i) {
+            counters[i] = static_cast<double>(paths.taken[i].load());
+        }
+        if (*preset) {
+            paths.reset();
+        }
+
+        return row_vector_to_fp(Map<const VectorXd>(counters, n));
     }
     catch (...) {
         return nullptr;
@@ -0,0 +1,675 @@
+// ==============================================================================
+// mapped.cpp - Out-of-core matrices in memory-mapped files
+// ==============================================================================
+// \MATRIX.MAP.CREATE and \MATRIX.MAP.OPEN return handles to matrices stored in
+// files. MATRIX.MAP.WRITE fills them a range at a time and MATRIX.MAP.SLICE
+// copies out only the window a formula displays. MATRIX.MAP.MMULT,
+// MATRIX.MAP.GRAM and MATRIX.MAP.MATVEC work one block at a time so only a few
+// blocks of each operand need to be resident.
+// ==============================================================================
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mapped.h"
+#include "async.h"
+
+using namespace xll;
+using namespace Eigen;
+
+namespace {
+
+    constexpr char magic[8] = {'X', 'L', 'L', 'T', 'I', 'L', 'E', '1'};
+    constexpr size_t header_bytes = 4096;
+
+    struct tiled_header {
+        char magic[8];
+        int64_t rows;
+        int64_t cols;
+        int64_t tile;
+    };
+
+    size_t tiled_bytes(Index rows, Index cols, Index tile)
+    {
+        ensure(rows > 0 && cols > 0 && tile > 0);
+        const size_t blocks = static_cast<size_t>((rows + tile - 1) / tile) * static_cast<size_t>((cols + tile - 1) / tile);
+
+        return header_bytes + blocks * static_cast<size_t>(tile * tile) * sizeof(double);
+    }
+
+    // Ask the operating system to start reading [p, p + n) in the background
+    void prefetch(const void* p, size_t n) noexcept
+    {
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<void*>(p), n};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        (void)p;
+        (void)n;
+#endif
+#else
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(p) & ~(page - 1);
+        madvise(reinterpret_cast<void*>(begin), reinterpret_cast<uintptr_t>(p) + n - begin, MADV_WILLNEED);
+#endif
+    }
+
+    // Canonical paths of the files mapped by live mapped_file objects
+    std::mutex mapped_mutex;
+    std::multiset<std::filesystem::path> mapped_paths;
+
+} // namespace
+
+// ==============================================================================
+// mapped_file
+// ==============================================================================
+
+mapped_file::mapped_file(const std::filesystem::path& path, size_t size)
+    : length(size)
+{
+    try {
+        {
+            auto canonical = std::filesystem::weakly_canonical(path);
+            std::lock_guard lock(mapped_mutex);
+            ensure_message(!size || !mapped_paths.contains(canonical), "file is mapped by another handle");
+            mapped_paths.insert(canonical);
+            key = std::move(canonical);
+        }
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            size ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        ensure(file != INVALID_HANDLE_VALUE);
+        if (!size) {
+            LARGE_INTEGER bytes;
+            ensure(GetFileSizeEx(file, &bytes));
+            length = static_cast<size_t>(bytes.QuadPart);
+        }
+        ensure(length > 0);
+        // A mapping larger than the file extends it with zeros
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(static_cast<uint64_t>(length) >> 32), static_cast<DWORD>(length & 0xFFFFFFFF), nullptr);
+        ensure(mapping);
+        base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, length);
+        ensure(base);
+#else
+        fd = ::open(path.c_str(), size ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+        ensure(fd >= 0);
+        if (size) {
+            // Sparse on most file systems: unwritten blocks read as zero
+            ensure(::ftruncate(fd, static_cast<off_t>(size)) == 0);
+        }
+        else {
+            struct stat st;
+            ensure(::fstat(fd, &st) == 0);
+            length = static_cast<size_t>(st.st_size);
+        }
+        ensure(length > 0);
+        base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+        }
+        ensure(base);
+#endif
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+void mapped_file::close() noexcept
+{
+#ifdef _WIN32
+    if (base) {
+        UnmapViewOfFile(base);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (base) {
+        ::munmap(base, length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+#endif
+    base = nullptr;
+
+    if (!key.empty()) {
+        std::lock_guard lock(mapped_mutex);
+        mapped_paths.erase(mapped_paths.find(key));
+        key.clear();
+    }
+}
+
+// ==============================================================================
+// tiled_matrix
+// ==============================================================================
+
+tiled_matrix::tiled_matrix(const std::filesystem::path& path, Index rows, Index cols, Index tile)
+    : file(path, tiled_bytes(rows, cols, tile)),
+      rows_(rows), cols_(cols), tile_(tile),
+      data_(reinterpret_cast<double*>(file.data() + header_bytes))
+{
+    tiled_header* p = reinterpret_cast<tiled_header*>(file.data());
+    std::memcpy(p->magic, magic, sizeof(magic));
+    p->rows = rows;
+    p->cols = cols;
+    p->tile = tile;
+}
+
+tiled_matrix::tiled_matrix(const std::filesystem::path& path)
+    : file(path, 0), rows_(0), cols_(0), tile_(0), data_(nullptr)
+{
+    ensure(file.size() >= header_bytes);
+    const tiled_header* p = reinterpret_cast<const tiled_header*>(file.data());
+    ensure(std::memcmp(p->magic, magic, sizeof(magic)) == 0);
+    ensure(p->rows > 0 && p->cols > 0 && p->tile > 0);
+    rows_ = static_cast<Index>(p->rows);
+    cols_ = static_cast<Index>(p->cols);
+    tile_ = static_cast<Index>(p->tile);
+    ensure(file.size() >= tiled_bytes(rows_, cols_, tile_));
+    data_ = reinterpret_cast<double*>(file.data() + header_bytes);
+}
+
+tiled_matrix::block_map tiled_matrix::block(Index bi, Index bj) const
+{
+    double* p = data_ + (bi * block_cols() + bj) * tile_ * tile_;
+
+    return block_map(p, (std::min)(tile_, rows_ - bi * tile_), (std::min)(tile_, cols_ - bj * tile_), OuterStride<>(tile_));
+}
+
+void tiled_matrix::read(Index row0, Index col0, Eigen::Ref<RowMatrixXd> A) const
+{
+    ensure(row0 >= 0 && col0 >= 0 && row0 + A.rows() <= rows_ && col0 + A.cols() <= cols_);
+
+    for (Index i = row0; i < row0 + A.rows(); i = (i / tile_ + 1) * tile_) {
+        const Index h = (std::min)((i / tile_ + 1) * tile_, row0 + A.rows()) - i;
+        for (Index j = col0; j < col0 + A.cols(); j = (j / tile_ + 1) * tile_) {
+            const Index w = (std::min)((j / tile_ + 1) * tile_, col0 + A.cols()) - j;
+            A.block(i - row0, j - col0, h, w) = block(i / tile_, j / tile_).block(i % tile_, j % tile_, h, w);
+        }
+    }
+}
+
+void tiled_matrix::write(Index row0, Index col0, const Eigen::Ref<const RowMatrixXd>& A)
+{
+    ensure(row0 >= 0 && col0 >= 0 && row0 + A.rows() <= rows_ && col0 + A.cols() <= cols_);
+
+    for (Index i = row0; i < row0 + A.rows(); i = (i / tile_ + 1) * tile_) {
+        const Index h = (std::min)((i / tile_ + 1) * tile_, row0 + A.rows()) - i;
+        for (Index j = col0; j < col0 + A.cols(); j = (j / tile_ + 1) * tile_) {
+            const Index w = (std::min)((j / tile_ + 1) * tile_, col0 + A.cols()) - j;
+            block(i / tile_, j / tile_).block(i % tile_, j % tile_, h, w) = A.block(i - row0, j - col0, h, w);
+        }
+    }
+}
+
+// ==============================================================================
+// Tiled kernels
+// ==============================================================================
+
+void xll::tiled_multiply(const tiled_matrix& A, const tiled_matrix& B, tiled_matrix& C)
+{
+    ensure(A.cols() == B.rows() && C.rows() == A.rows() && C.cols() == B.cols());
+    ensure(A.tile() == B.tile() && A.tile() == C.tile());
+
+    const Index nj = C.block_cols();
+    const Index nk = A.block_cols();
+
+    // Consecutive blocks of C share a block row of A
+    parallel_for(C.block_rows() * nj, 1, [&](Index begin, Index end) {
+        RowMatrixXd acc;
+        for (Index b = begin; b < end; ++b) {
+            const Index bi = b / nj;
+            const Index bj = b % nj;
+            auto c = C.block(bi, bj);
+            acc.setZero(c.rows(), c.cols());
+            for (Index bk = 0; bk < nk; ++bk) {
+                acc.noalias() += A.block(bi, bk) * B.block(bk, bj);
+            }
+            c = acc;
+        }
+    });
+}
+
+MatrixXd xll::tiled_gram(const tiled_matrix& A)
+{
+    const Index t = A.tile();
+    const Index nb = A.block_cols();
+    const size_t band = static_cast<size_t>(nb * t * t) * sizeof(double);
+
+    // Lower triangle of block pairs (k, j) with k >= j
+    std::vector<std::pair<Index, Index>> pairs;
+    for (Index j = 0; j < nb; ++j) {
+        for (Index k = j; k < nb; ++k) {
+            pairs.emplace_back(k, j);
+        }
+    }
+
+    MatrixXd G = MatrixXd::Zero(A.cols(), A.cols());
+    for (Index bi = 0; bi < A.block_rows(); ++bi) {
+        // A block row is contiguous in the file, so read ahead the next one
+        if (bi + 1 < A.block_rows()) {
+            prefetch(A.block(bi + 1, 0).data(), band);
+        }
+        // Each pair owns a distinct block of G
+        parallel_for(static_cast<Index>(pairs.size()), 1, [&](Index begin, Index end) {
+            for (Index p = begin; p < end; ++p) {
+                const auto [k, j] = pairs[static_cast<size_t>(p)];
+                const auto Aj = A.block(bi, j);
+                if (k == j) {
+                    G.block(j * t, j * t, Aj.cols(), Aj.cols()).selfadjointView<Lower>().rankUpdate(Aj.transpose());
+                }
+                else {
+                    const auto Ak = A.block(bi, k);
+                    G.block(k * t, j * t, Ak.cols(), Aj.cols()).noalias() += Ak.transpose() * Aj;
+                }
+            }
+        });
+    }
+
+    return G.selfadjointView<Lower>();
+}
+
+VectorXd xll::tiled_multiply(const tiled_matrix& A, const Eigen::Ref<const VectorXd>& x)
+{
+    ensure(x.size() == A.cols());
+
+    const Index t = A.tile();
+    VectorXd y(A.rows());
+    parallel_for(A.block_rows(), 1, [&](Index begin, Index end) {
+        for (Index bi = begin; bi < end; ++bi) {
+            auto yi = y.segment(bi * t, (std::min)(t, A.rows() - bi * t));
+            yi.setZero();
+            for (Index bj = 0; bj < A.block_cols(); ++bj) {
+                const auto a = A.block(bi, bj);
+                yi.noalias() += a * x.segment(bj * t, a.cols());
+            }
+        }
+    });
+
+    return y;
+}
+
+namespace {
+
+    std::filesystem::path file_path(const OPER& o)
+    {
+        ensure(isStr(o) && count(o) > 0);
+
+        return std::filesystem::path(std::wstring(view(o)));
+    }
+
+    // Delete the matrix handle the calling cell returned before, which this
+    // call replaces, so a file it maps can be created again at the same path.
+    // A lookup of a handle created by the calling cell erases it on return.
+    void release_caller()
+    {
+        const OPER o = Excel(xlCoerce, Excel(xlfCaller));
+        if (o.xltype == xltypeNum && is_handle(o.val.num)) {
+            handle<tiled_matrix> previous(o.val.num);
+        }
+    }
+
+} // namespace
+
+// ==============================================================================
+// Memory-Mapped Matrix Functions (8 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.MAP.CREATE - New matrix in a file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_create(
+    Function(XLL_HANDLEX, "xll_matrix_map_create", "\\MATRIX.MAP.CREATE")
+    .Arguments({
+        Arg(XLL_LPOPER, "file", "is the path of the file to create. An existing file that is not mapped is overwritten."),
+        Arg(XLL_DOUBLE, "rows", "is the number of rows."),
+        Arg(XLL_DOUBLE, "cols", "is the number of columns."),
+        Arg(XLL_DOUBLE, "tile", "is the optional edge length of a block. Default is 256.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a zero matrix stored in a memory-mapped file.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Creates a file holding a rows×cols matrix of zeros and maps it into memory.
+The matrix may be larger than the worksheet and larger than physical memory;
+the operating system pages blocks in and out as they are used.</p>
+<p>The file is a 4096 byte header followed by tile×tile blocks of doubles,
+block rows first and each block row-major. Fill it with MATRIX.MAP.WRITE or
+by writing the same layout from another program.</p>
+<p>The file stays mapped until the handle is deleted. Returns an error if the
+file is mapped by a handle from another cell, since truncating it would
+invalidate that handle.</p>
+<p><b>Output:</b> Handle to the matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_map_create(LPOPER pfile, double rows, double cols, double tile)
+{
+#pragma XLLEXPORT
+    try {
+        release_caller();
+        handle<tiled_matrix> h(new tiled_matrix(file_path(*pfile), to_index(rows), to_index(cols),
+            tile ? to_index(tile) : tiled_matrix::default_tile));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.MAP.OPEN - Existing matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_open(
+    Function(XLL_HANDLEX, "xll_matrix_map_open", "\\MATRIX.MAP.OPEN")
+    .Arguments({
+        Arg(XLL_LPOPER, "file", "is the path of a file created by \\MATRIX.MAP.CREATE.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a matrix stored in an existing memory-mapped file.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Maps a matrix file read-write without reading it. Blocks are paged in when
+a function touches them. Writes through the handle change the file.</p>
+<p><b>Output:</b> Handle to the matrix</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_map_open(LPOPER pfile)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(new tiled_matrix(file_path(*pfile)));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MAP.WRITE - Copy a range into a matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_write(
+    Function(XLL_HANDLEX, "xll_matrix_map_write", "MATRIX.MAP.WRITE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.MAP.CREATE or \\MATRIX.MAP.OPEN."),
+        Arg(XLL_FP, "A", "is the block of values to write."),
+        Arg(XLL_DOUBLE, "row", "is the optional 1-based row of the top left cell. Default is 1."),
+        Arg(XLL_DOUBLE, "col", "is the optional 1-based column of the top left cell. Default is 1.")
+    })
+    .FunctionHelp("Write a range into a memory-mapped matrix and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies A into the mapped matrix at (row, col). Only the blocks A overlaps are
+touched. Build a large matrix from several ranges by chaining calls through the
+returned handle so Excel orders them.</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_map_write(HANDLEX _h, _FP12* pa, double row, double col)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(_h);
+        ensure(h);
+
+        h->write(first_index(row), first_index(col), fp_map(pa));
+
+        return _h;
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MAP.SLICE - Copy a window out of a matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_slice(
+    Function(XLL_FP, "xll_matrix_map_slice", "MATRIX.MAP.SLICE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.MAP.CREATE or \\MATRIX.MAP.OPEN."),
+        Arg(XLL_DOUBLE, "row", "is the optional 1-based first row. Default is 1."),
+        Arg(XLL_DOUBLE, "col", "is the optional 1-based first column. Default is 1."),
+        Arg(XLL_DOUBLE, "rows", "is the optional number of rows. Default is the rest of the matrix."),
+        Arg(XLL_DOUBLE, "cols", "is the optional number of columns. Default is the rest of the matrix.")
+    })
+    .FunctionHelp("Return a window of a memory-mapped matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Copies only the requested window, so the cost is proportional to the cells
+returned and the blocks they overlap, not to the size of the matrix.</p>
+<p><b>Output:</b> The window (rows×cols)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_map_slice(HANDLEX _h, double row, double col, double rows, double cols)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        const Index i = first_index(row);
+        const Index j = first_index(col);
+        const Index m = rows ? to_index(rows) : h->rows() - i;
+        const Index n = cols ? to_index(cols) : h->cols() - j;
+        ensure(m > 0 && n > 0);
+
+        _FP12* result = fp_alloc(m, n);
+        auto window = fp_out(result);
+        h->read(i, j, window);
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MAP.SIZE - Dimensions of a matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_size(
+    Function(XLL_FP, "xll_matrix_map_size", "MATRIX.MAP.SIZE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\MATRIX.MAP.CREATE or \\MATRIX.MAP.OPEN.")
+    })
+    .FunctionHelp("Return the rows, columns and block size of a memory-mapped matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p><b>Output:</b> Row vector {rows, cols, tile} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_map_size(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        const double size[3] = {
+            static_cast<double>(h->rows()),
+            static_cast<double>(h->cols()),
+            static_cast<double>(h->tile())
+        };
+
+        return row_vector_to_fp(Map<const VectorXd>(size, 3));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.MAP.MMULT - Out-of-core matrix product
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_mmult(
+    Function(XLL_HANDLEX, "xll_matrix_map_mmult", "\\MATRIX.MAP.MMULT")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle to a memory-mapped matrix."),
+        Arg(XLL_HANDLEX, "B", "is a handle to a memory-mapped matrix with the same block size."),
+        Arg(XLL_LPOPER, "file", "is the path of the file for the product. An existing file that is not mapped is overwritten.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the product of two memory-mapped matrices.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[C = AB\] into a new matrix file one block of C at a time:
+\[C_{ij} = \sum_k A_{ik} B_{kj}\] is accumulated in memory and written once.
+Blocks of C are computed in parallel, and consecutive blocks share a block row
+of A so it is read from the page cache rather than the disk.</p>
+<p>Returns an error if the file is mapped by a handle from another cell,
+including A and B.</p>
+<p><b>Input:</b> A(m×k), B(k×n)</p>
+<p><b>Output:</b> Handle to C(m×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_matrix_map_mmult(HANDLEX _a, HANDLEX _b, LPOPER pfile)
+{
+#pragma XLLEXPORT
+    try {
+        release_caller();
+        handle<tiled_matrix> a(_a);
+        handle<tiled_matrix> b(_b);
+        ensure(a && b);
+
+        handle<tiled_matrix> h(new tiled_matrix(file_path(*pfile), a->rows(), b->cols(), a->tile()));
+        tiled_multiply(*a.ptr(), *b.ptr(), *h.ptr());
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MAP.GRAM - A^T A of a matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_gram(
+    Function(XLL_FP, "xll_matrix_map_gram", "MATRIX.MAP.GRAM")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a memory-mapped matrix.")
+    })
+    .FunctionHelp("Return the Gram matrix of a memory-mapped matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[A^T A = \sum_i A_i^T A_i\] over block rows \[A_i\] in one pass
+over the file. Each block row is contiguous and the next one is read ahead
+while the current one is multiplied. Only the lower triangle of block pairs is
+computed, in parallel.</p>
+<p><b>Input:</b> A(m×n) where m may exceed the worksheet</p>
+<p><b>Output:</b> Symmetric matrix (n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_map_gram(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        return eigen_to_fp(tiled_gram(*h.ptr()));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MAP.MATVEC - A x of a matrix file
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_map_matvec(
+    Function(XLL_FP, "xll_matrix_map_matvec", "MATRIX.MAP.MATVEC")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a memory-mapped matrix."),
+        Arg(XLL_FP, "x", "is a vector with one entry per column.")
+    })
+    .FunctionHelp("Return the product of a memory-mapped matrix and a vector.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes \[y = Ax\] in one pass over the file, block rows in parallel.</p>
+<p><b>Input:</b> A(m×n), x(n)</p>
+<p><b>Output:</b> Column vector y (m×1)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_map_matvec(HANDLEX _h, _FP12* px)
+{
+#pragma XLLEXPORT
+    try {
+        handle<tiled_matrix> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        return vector_to_fp(tiled_multiply(*h.ptr(), Map<const VectorXd>(px->array, xll::size(*px))));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,364 @@
+// ==============================================================================
+// masked.cpp - Covariance, regression and reductions with missing data
+// ==============================================================================
+// MATRIX.MASKED.COV, MATRIX.MASKED.CORR, MATRIX.MASKED.REGRESS and
+// MATRIX.MASKED.REDUCE accept ranges containing blanks, text or errors and
+// skip those cells instead of failing.
+// ==============================================================================
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include "masked.h"
+
+using namespace xll;
+using namespace Eigen;
+
+masked_matrix::masked_matrix(const XLOPER12& x)
+{
+    const XLOPER12* cell = &x;
+    Index rows = 1, cols = 1;
+    if (type(x) == xltypeMulti) {
+        cell = x.val.array.lparray;
+        rows = x.val.array.rows;
+        cols = x.val.array.columns;
+    }
+    ensure(rows > 0 && cols > 0);
+
+    const size_t n = static_cast<size_t>(rows * cols);
+    values_.resize(rows, cols);
+    bits_.assign((n + 63) / 64, 0);
+
+    double* v = values_.data();
+    for (size_t k = 0; k < n; ++k) {
+        if (type(cell[k]) == xltypeNum) {
+            v[k] = cell[k].val.num;
+            bits_[k >> 6] |= uint64_t(1) << (k & 63);
+        }
+        else {
+            v[k] = 0;
+        }
+    }
+
+    linalg_traffic().copied.fetch_add(sizeof(double) * n, std::memory_order_relaxed);
+}
+
+bool masked_matrix::complete(Eigen::Index i) const
+{
+    for (Index j = 0; j < cols(); ++j) {
+        if (!valid(i, j)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Eigen::Index masked_matrix::count() const
+{
+    Index n = 0;
+    for (const uint64_t b : bits_) {
+        n += std::popcount(b);
+    }
+
+    return n;
+}
+
+RowMatrixXd masked_matrix::mask() const
+{
+    RowMatrixXd M(rows(), cols());
+    for (Index i = 0; i < rows(); ++i) {
+        for (Index j = 0; j < cols(); ++j) {
+            M(i, j) = valid(i, j);
+        }
+    }
+
+    return M;
+}
+
+Eigen::MatrixXd xll::pairwise_covariance(const masked_matrix& X, bool correlation)
+{
+    const RowMatrixXd M = X.mask();
+
+    // Shift each column by its mean over valid cells to limit cancellation
+    const RowVectorXd counts = M.colwise().sum();
+    const RowVectorXd shift = (X.values().colwise().sum().array() / counts.array().max(1.)).matrix();
+    const RowMatrixXd Z = ((X.values().rowwise() - shift).array() * M.array()).matrix();
+
+    // Entry (j,k) sums over the rows where columns j and k are both valid
+    const MatrixXd N = M.transpose() * M;
+    const MatrixXd Sx = Z.transpose() * M;  // Σ z_j
+    const MatrixXd Sxy = Z.transpose() * Z; // Σ z_j z_k
+
+    MatrixXd C(X.cols(), X.cols());
+    if (!correlation) {
+        C = ((Sxy.array() - Sx.array() * Sx.transpose().array() / N.array()) / (N.array() - 1)).matrix();
+    }
+    else {
+        const MatrixXd Sxx = Z.cwiseAbs2().transpose() * M; // Σ z_j²
+        const ArrayXXd vx = Sxx.array() - Sx.array().square() / N.array();
+        C = ((Sxy.array() - Sx.array() * Sx.transpose().array() / N.array())
+            / (vx * vx.transpose()).sqrt()).matrix();
+    }
+
+    for (Index j = 0; j < C.rows(); ++j) {
+        for (Index k = 0; k < C.cols(); ++k) {
+            if (N(j, k) < 2) {
+                C(j, k) = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+
+    return C;
+}
+
+Eigen::VectorXd xll::masked_regress(const masked_matrix& y, const masked_matrix& X, bool intercept, Eigen::Index& used)
+{
+    ensure(y.cols() == 1 && y.rows() == X.rows());
+
+    const Index p = X.cols() + intercept;
+    MatrixXd A(X.rows(), p);
+    VectorXd b(X.rows());
+    used = 0;
+    for (Index i = 0; i < X.rows(); ++i) {
+        if (y.valid(i, 0) && X.complete(i)) {
+            if (intercept) {
+                A(used, 0) = 1;
+            }
+            A.row(used).tail(X.cols()) = X.values().row(i);
+            b(used) = y.values()(i, 0);
+            ++used;
+        }
+    }
+    ensure(used >= p);
+
+    return A.topRows(used).colPivHouseholderQr().solve(b.head(used));
+}
+
+namespace {
+
+    enum reduce_op { op_sum, op_mean, op_count, op_min, op_max, op_var, op_stdev };
+
+    // Running count, sum, extremes and Welford variance
+    struct reduction {
+        Index n = 0;
+        double sum = 0;
+        double mean = 0;
+        double m2 = 0;
+        double lo = std::numeric_limits<double>::infinity();
+        double hi = -std::numeric_limits<double>::infinity();
+
+        void add(double x)
+        {
+            ++n;
+            sum += x;
+            const double d = x - mean;
+            mean += d / static_cast<double>(n);
+            m2 += d * (x - mean);
+            lo = (std::min)(lo, x);
+            hi = (std::max)(hi, x);
+        }
+
+        double result(int op) const
+        {
+            constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+            switch (op) {
+            case op_sum:
+                return sum;
+            case op_mean:
+                return n ? mean : nan;
+            case op_count:
+                return static_cast<double>(n);
+            case op_min:
+                return n ? lo : nan;
+            case op_max:
+                return n ? hi : nan;
+            case op_var:
+                return n > 1 ? m2 / static_cast<double>(n - 1) : nan;
+            case op_stdev:
+                return n > 1 ? std::sqrt(m2 / static_cast<double>(n - 1)) : nan;
+            }
+
+            return nan;
+        }
+    };
+
+} // namespace
+
+// ==============================================================================
+// Masked Functions (4 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.MASKED.COV - Pairwise-complete covariance
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_masked_cov(
+    Function(XLL_FP, "xll_matrix_masked_cov", "MATRIX.MASKED.COV")
+    .Arguments({
+        Arg(XLL_LPOPER, "X", "is a range with observations in rows that may contain blanks or errors.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the covariance of each pair of columns over rows where both are numbers.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Entry (j,k) is the sample covariance of columns j and k over the rows where
+both cells are numbers, with denominator one less than the number of such rows.
+Blank, text and error cells are skipped. Pairs with fewer than two complete
+rows return #NUM!. The result need not be positive semidefinite.</p>
+<p><b>Input:</b> X(m×n)</p>
+<p><b>Output:</b> Covariance matrix (n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_masked_cov(LPOPER px)
+{
+#pragma XLLEXPORT
+    try {
+        return eigen_to_fp(pairwise_covariance(masked_matrix(*px)));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MASKED.CORR - Pairwise-complete correlation
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_masked_corr(
+    Function(XLL_FP, "xll_matrix_masked_corr", "MATRIX.MASKED.CORR")
+    .Arguments({
+        Arg(XLL_LPOPER, "X", "is a range with observations in rows that may contain blanks or errors.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the correlation of each pair of columns over rows where both are numbers.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Entry (j,k) is the Pearson correlation of columns j and k over the rows where
+both cells are numbers. Means and variances are taken over the same rows.
+Pairs with fewer than two complete rows return #NUM!.</p>
+<p><b>Input:</b> X(m×n)</p>
+<p><b>Output:</b> Correlation matrix (n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_masked_corr(LPOPER px)
+{
+#pragma XLLEXPORT
+    try {
+        return eigen_to_fp(pairwise_covariance(masked_matrix(*px), true));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MASKED.REGRESS - Least squares over complete rows
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_masked_regress(
+    Function(XLL_FP, "xll_matrix_masked_regress", "MATRIX.MASKED.REGRESS")
+    .Arguments({
+        Arg(XLL_LPOPER, "y", "is a column of responses that may contain blanks or errors."),
+        Arg(XLL_LPOPER, "X", "is a range of regressors with the same number of rows as y."),
+        Arg(XLL_LPOPER, "intercept", "is an optional boolean to fit an intercept. Default is TRUE.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Regress y on X using only the rows where y and every column of X are numbers.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves \[\min_\beta \|y - X\beta\|_2\] over complete rows with
+column-pivoting QR. Rows with any blank, text or error cell are dropped.</p>
+<p><b>Input:</b> y(m×1), X(m×p)</p>
+<p><b>Output:</b> Coefficients with the intercept first if fitted, followed by
+the number of rows used ((p+2)×1 or (p+1)×1)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_masked_regress(LPOPER py, LPOPER px, LPOPER pintercept)
+{
+#pragma XLLEXPORT
+    try {
+        const bool intercept = isMissing(*pintercept) || isNil(*pintercept) || isTrue(*pintercept);
+
+        Index used = 0;
+        const VectorXd beta = masked_regress(masked_matrix(*py), masked_matrix(*px), intercept, used);
+
+        _FP12* result = fp_alloc(beta.size() + 1, 1);
+        fp_out(result).col(0).head(beta.size()) = beta;
+        result->array[beta.size()] = static_cast<double>(used);
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.MASKED.REDUCE - Reductions that skip missing cells
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_masked_reduce(
+    Function(XLL_FP, "xll_matrix_masked_reduce", "MATRIX.MASKED.REDUCE")
+    .Arguments({
+        Arg(XLL_LPOPER, "X", "is a range that may contain blanks or errors."),
+        Arg(XLL_LPOPER, "op", "is the optional reduction \"SUM\", \"MEAN\", \"COUNT\", \"MIN\", \"MAX\", \"VAR\", or \"STDEV\". Default is \"SUM\"."),
+        Arg(XLL_LPOPER, "axis", "is the optional direction \"COLUMNS\", \"ROWS\", or \"ALL\". Default is \"COLUMNS\".")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Reduce the numeric cells of each column, each row, or the whole range.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Blank, text and error cells are skipped. VAR and STDEV are sample statistics
+computed with Welford's update. Empty groups return #NUM! except for SUM and
+COUNT, which return 0.</p>
+<p><b>Input:</b> X(m×n)</p>
+<p><b>Output:</b> Row vector (1×n) for COLUMNS, column vector (m×1) for ROWS,
+or a scalar (1×1) for ALL</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_masked_reduce(LPOPER px, LPOPER pop, LPOPER paxis)
+{
+#pragma XLLEXPORT
+    try {
+        const int op = option(*pop, { "SUM", "MEAN", "COUNT", "MIN", "MAX", "VAR", "STDEV" }, op_sum);
+        const int axis = option(*paxis, { "COLUMNS", "ROWS", "ALL" }, 0);
+        if (op < op_sum || op > op_stdev || axis < 0 || axis > 2) {
+            return nullptr;
+        }
+
+        const masked_matrix X(*px);
+        const RowMatrixXd& v = X.values();
+        std::vector<reduction> r(axis == 0 ? X.cols() : axis == 1 ? X.rows() : 1);
+        for (Index i = 0; i < X.rows(); ++i) {
+            for (Index j = 0; j < X.cols(); ++j) {
+                if (X.valid(i, j)) {
+                    r[axis == 0 ? j : axis == 1 ? i : 0].add(v(i, j));
+                }
+            }
+        }
+
+        _FP12* result = axis == 0 ? fp_alloc(1, X.cols()) : fp_alloc(static_cast<Index>(r.size()), 1);
+        for (size_t k = 0; k < r.size(); ++k) {
+            result->array[k] = r[k].result(op);
+        }
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,435 @@
+// ==============================================================================
+// regress.cpp - Linear regression
+// ==============================================================================
+// MATRIX.REGRESS returns coefficients, standard errors, t statistics, R², F
+// and residuals for many responses from one factorization.
+// \REGRESS.STREAM returns a handle that accumulates observations with
+// REGRESS.STREAM.ADD. Coefficients and statistics are read from the running
+// factor without revisiting earlier rows.
+// ==============================================================================
+
+#include <cmath>
+#include <limits>
+#include "regress.h"
+#include "async.h"
+#include "factor.h"
+
+using namespace xll;
+using namespace Eigen;
+
+regression xll::regress(const Eigen::Ref<const RowMatrixXd>& X, const Eigen::Ref<const RowMatrixXd>& Y,
+    const double* w, bool intercept)
+{
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    const Index m = X.rows();
+    const Index k = X.cols();
+    const Index p = k + intercept;
+    const Index q = Y.cols();
+    ensure(Y.rows() == m && p > 0 && q > 0);
+
+    // Weighted least squares is ordinary least squares on rows scaled by √w
+    VectorXd wv = VectorXd::Ones(m);
+    if (w) {
+        wv = Map<const VectorXd>(w, m);
+    }
+    const VectorXd sw = wv.cwiseSqrt();
+    const double wsum = wv.sum();
+    const double n = static_cast<double>((wv.array() > 0).count());
+
+    MatrixXd A(m, p);
+    if (intercept) {
+        A.col(0) = sw;
+    }
+    A.rightCols(k) = sw.asDiagonal() * X;
+    const ColPivHouseholderQR<MatrixXd> qr(A);
+
+    regression r;
+    r.rank = qr.rank();
+    r.dof = n - static_cast<double>(r.rank);
+
+    // diag((A^T A)^-1) is the squared row norms of R^-1 on the leading rank columns
+    MatrixXd Rinv = MatrixXd::Identity(r.rank, r.rank);
+    qr.matrixR().topLeftCorner(r.rank, r.rank).triangularView<Upper>().solveInPlace(Rinv);
+    VectorXd d = VectorXd::Constant(p, nan);
+    for (Index i = 0; i < r.rank; ++i) {
+        d(qr.colsPermutation().indices()(i)) = Rinv.row(i).squaredNorm();
+    }
+
+    r.coefficients.resize(p, q);
+    r.errors.resize(p, q);
+    r.r2.resize(q);
+    r.f.resize(q);
+    r.sigma.resize(q);
+    r.residuals.resize(m, q);
+    const double dfm = static_cast<double>(r.rank - intercept);
+
+    parallel_for(q, 1, [&](Index b, Index e) {
+        const auto Yb = Y.middleCols(b, e - b);
+        const MatrixXd beta = qr.solve(sw.asDiagonal() * Yb);
+        r.coefficients.middleCols(b, e - b) = beta;
+        r.residuals.middleCols(b, e - b) = Yb - X * beta.bottomRows(k);
+        if (intercept) {
+            r.residuals.middleCols(b, e - b).rowwise() -= beta.row(0);
+        }
+
+        for (Index j = b; j < e; ++j) {
+            const auto y = Y.col(j);
+            const double sse = wv.dot(r.residuals.col(j).cwiseAbs2());
+            const double center = intercept ? wv.dot(y) / wsum : 0;
+            const double tss = wv.dot((y.array() - center).square().matrix());
+            const double sigma2 = r.dof > 0 ? sse / r.dof : nan;
+
+            r.sigma(j) = std::sqrt(sigma2);
+            r.errors.col(j) = (sigma2 * d.array()).sqrt();
+            r.r2(j) = 1 - sse / tss;
+            r.f(j) = dfm > 0 ? (tss - sse) / dfm / sigma2 : nan;
+        }
+    });
+
+    return r;
+}
+
+regress_stream::regress_stream(Eigen::Index regressors, double lambda_, Eigen::Index window_, bool intercept_)
+    : p(regressors + intercept_), intercept(intercept_), lambda(lambda_), window(window_),
+      R(RowMatrixXd::Zero(p + 1, p + 1))
+{
+    ensure(regressors >= 0 && p > 0);
+    ensure(lambda > 0 && lambda <= 1);
+    ensure(window >= 0 && (window == 0 || lambda == 1));
+}
+
+void regress_stream::refactor()
+{
+    R.setZero();
+    for (const auto& z : rows) {
+        triangular_update(R, z);
+    }
+}
+
+void regress_stream::add(const Eigen::Ref<const RowMatrixXd>& X, const Eigen::Ref<const Eigen::VectorXd>& y)
+{
+    ensure(X.cols() == p - intercept && X.rows() == y.size());
+
+    const double scale = std::sqrt(lambda);
+    RowVectorXd z(p + 1);
+    if (intercept) {
+        z(0) = 1;
+    }
+    for (Index i = 0; i < X.rows(); ++i) {
+        z.segment(intercept, X.cols()) = X.row(i);
+        z(p) = y(i);
+
+        if (lambda < 1) {
+            R *= scale;
+            weight *= lambda;
+        }
+        triangular_update(R, z);
+        weight += 1;
+
+        if (window) {
+            rows.push_back(z);
+            if (static_cast<Index>(rows.size()) > window) {
+                const RowVectorXd old = rows.front();
+                rows.pop_front();
+                weight -= 1;
+                if (!triangular_downdate(R, old)) {
+                    refactor();
+                    ++refactored;
+                }
+            }
+        }
+    }
+}
+
+Eigen::VectorXd regress_stream::coefficients() const
+{
+    const auto Rx = R.topLeftCorner(p, p);
+    ensure(Rx.diagonal().cwiseAbs().minCoeff() > 0); // full column rank
+
+    return Rx.triangularView<Upper>().solve(R.col(p).head(p));
+}
+
+double regress_stream::variance() const
+{
+    return weight > p ? R(p, p) * R(p, p) / (weight - p) : std::numeric_limits<double>::quiet_NaN();
+}
+
+Eigen::VectorXd regress_stream::errors() const
+{
+    // diag((X^T X)^-1) is the squared row norms of R_x^-1
+    MatrixXd Rinv = MatrixXd::Identity(p, p);
+    R.topLeftCorner(p, p).triangularView<Upper>().solveInPlace(Rinv);
+
+    return std::sqrt(variance()) * Rinv.rowwise().norm();
+}
+
+// ==============================================================================
+// Streaming Regression Functions (4 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \REGRESS.STREAM - Recursive least squares handle
+// -----------------------------------------------------------------------------
+AddIn xai_regress_stream(
+    Function(XLL_HANDLEX, "xll_regress_stream", "\\REGRESS.STREAM")
+    .Arguments({
+        Arg(XLL_DOUBLE, "p", "is the number of regressors, not counting the intercept."),
+        Arg(XLL_DOUBLE, "lambda", "is the optional forgetting factor in (0, 1]. Default is 1."),
+        Arg(XLL_DOUBLE, "window", "is the optional number of latest rows to keep. Default is 0 for all rows."),
+        Arg(XLL_LPOPER, "intercept", "is an optional boolean to fit an intercept. Default is TRUE.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a streaming least squares regression.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Fits \[y \approx X\beta\] as rows arrive with REGRESS.STREAM.ADD, in O(p²) per
+row regardless of how many rows have been added.</p>
+<p>With lambda < 1 row i of n has weight \[\lambda^{n-i}\], so the estimate
+tracks recent data with an effective memory of 1/(1 - lambda) rows. With
+window > 0 only the latest window rows are fitted; leaving rows are removed
+with an O(p²) downdate, or by refitting the window if the downdate would be
+inaccurate. The two options cannot be combined.</p>
+<p><b>Output:</b> Handle to the regression</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_regress_stream(double p, double lambda, double window, LPOPER pintercept)
+{
+#pragma XLLEXPORT
+    try {
+        const bool intercept = isMissing(*pintercept) || isNil(*pintercept) || isTrue(*pintercept);
+        handle<regress_stream> h(new regress_stream(static_cast<Index>(p), lambda ? lambda : 1,
+            static_cast<Index>(window), intercept));
+
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// REGRESS.STREAM.ADD - Add observations
+// -----------------------------------------------------------------------------
+AddIn xai_regress_stream_add(
+    Function(XLL_HANDLEX, "xll_regress_stream_add", "REGRESS.STREAM.ADD")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\REGRESS.STREAM."),
+        Arg(XLL_FP, "X", "is one or more rows of regressors."),
+        Arg(XLL_FP, "y", "is the response for each row of X.")
+    })
+    .FunctionHelp("Add rows to a streaming regression and return its handle.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Adds the rows of X with responses y in O(kp²) for k rows.</p>
+<p>Each cell adds its rows once. Recalculating the cell with the same handle, X
+and y leaves the handle unchanged, and changing them adds the new rows. Pass
+the result to REGRESS.STREAM.COEF or the next REGRESS.STREAM.ADD so Excel
+orders them.</p>
+<p><b>Input:</b> Handle, X(k×p), y(k×1)</p>
+<p><b>Output:</b> The same handle</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_regress_stream_add(HANDLEX _h, _FP12* px, _FP12* py)
+{
+#pragma XLLEXPORT
+    try {
+        handle<regress_stream> h(_h);
+        ensure(h);
+
+        // Recalculating the cell with the same rows does not add them again
+        std::vector<double> inputs{ static_cast<double>(px->rows), static_cast<double>(px->columns) };
+        inputs.insert(inputs.end(), px->array, px->array + xll::size(*px));
+        inputs.insert(inputs.end(), py->array, py->array + xll::size(*py));
+        const OPER caller = Excel(xlfCaller);
+        if (!h->applied.repeated(caller, inputs)) {
+            h->add(fp_map(px), Map<const VectorXd>(py->array, xll::size(*py)));
+            h->applied.record(caller, std::move(inputs));
+        }
+
+        return _h;
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// REGRESS.STREAM.COEF - Coefficients and standard errors
+// -----------------------------------------------------------------------------
+AddIn xai_regress_stream_coef(
+    Function(XLL_FP, "xll_regress_stream_coef", "REGRESS.STREAM.COEF")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\REGRESS.STREAM.")
+    })
+    .FunctionHelp("Return the coefficients and standard errors of a streaming regression.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves \[R_x \beta = z\] in O(p²). Standard errors are
+\[\sigma \sqrt{\mathrm{diag}((X^T W X)^{-1})}\] and return #NUM! until there are more
+observations than coefficients.</p>
+<p><b>Input:</b> Handle</p>
+<p><b>Output:</b> Coefficients and standard errors with the intercept first (p×2)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_regress_stream_coef(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<regress_stream> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        _FP12* result = fp_alloc(h->size(), 2);
+        fp_out(result).col(0) = h->coefficients();
+        fp_out(result).col(1) = h->errors();
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// REGRESS.STREAM.STATS - Residual variance and observation count
+// -----------------------------------------------------------------------------
+AddIn xai_regress_stream_stats(
+    Function(XLL_FP, "xll_regress_stream_stats", "REGRESS.STREAM.STATS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\REGRESS.STREAM.")
+    })
+    .FunctionHelp("Return the residual variance and effective observations of a streaming regression.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p><b>variance</b>: residual sum of squares divided by observations - p</p>
+<p><b>observations</b>: rows in the fit, or \[\sum \lambda^{n-i}\] with forgetting</p>
+<p><b>refactorizations</b>: window downdates that refitted the window instead</p>
+<p><b>Output:</b> Row vector {variance, observations, refactorizations} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_regress_stream_stats(HANDLEX _h)
+{
+#pragma XLLEXPORT
+    try {
+        handle<regress_stream> h(_h);
+        if (!h) {
+            return nullptr;
+        }
+
+        const double stats[3] = {
+            h->variance(),
+            h->observations(),
+            static_cast<double>(h->refactorizations())
+        };
+
+        return row_vector_to_fp(Map<const VectorXd>(stats, 3));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// ==============================================================================
+// Regression Functions (1 function)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.REGRESS - Multi-response least squares with statistics
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_regress(
+    Function(XLL_FP, "xll_matrix_regress", "MATRIX.REGRESS")
+    .Arguments({
+        Arg(XLL_FP, "Y", "is one or more response columns."),
+        Arg(XLL_FP, "X", "is the design matrix with the same number of rows as Y."),
+        Arg(XLL_LPOPER, "weights", "is an optional nonnegative weight for each row."),
+        Arg(XLL_LPOPER, "intercept", "is an optional boolean to fit an intercept. Default is TRUE."),
+        Arg(XLL_LPOPER, "output", "is the optional result \"ALL\", \"SUMMARY\", \"RESIDUALS\", or \"FITTED\". Default is \"ALL\".")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Regress each column of Y on X and return coefficients, statistics and residuals.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Minimizes \[\sum_i w_i (y_i - x_i\beta)^2\] for every column of Y. The
+weighted design is factored once with column-pivoting QR and response columns
+are solved in parallel. Columns of X that are linear combinations of earlier
+ones get coefficient 0 and standard error #NUM!.</p>
+<p>Each output column describes one response. SUMMARY has rows: coefficients
+(p, intercept first), standard errors (p), t statistics (p), R², F, residual
+standard error, residual degrees of freedom. R² and F are against the
+intercept-only model, or against zero without an intercept, as in LINEST.</p>
+<p><b>Input:</b> Y(m×q), X(m×k), optional weights(m)</p>
+<p><b>Output:</b> SUMMARY ((3p+4)×q), RESIDUALS or FITTED (m×q), or ALL with
+SUMMARY above RESIDUALS ((3p+4+m)×q), where p = k + 1 with an intercept</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_regress(_FP12* py, _FP12* px, LPOPER pweights, LPOPER pintercept, LPOPER poutput)
+{
+#pragma XLLEXPORT
+    try {
+        auto Y = fp_map(py);
+        auto X = fp_map(px);
+        const bool intercept = isMissing(*pintercept) || isNil(*pintercept) || isTrue(*pintercept);
+        const int output = option(*poutput, { "ALL", "SUMMARY", "RESIDUALS", "FITTED" }, 0);
+        if (output < 0 || X.rows() != Y.rows()) {
+            return nullptr;
+        }
+
+        VectorXd w;
+        if (!isMissing(*pweights) && !isNil(*pweights)) {
+            ensure(size(*pweights) == X.rows());
+            w.resize(X.rows());
+            for (Index i = 0; i < X.rows(); ++i) {
+                const OPER& wi = (*pweights)[static_cast<int>(i)];
+                ensure(isNum(wi) && Num(wi) >= 0);
+                w(i) = Num(wi);
+            }
+        }
+
+        const regression r = regress(X, Y, w.size() ? w.data() : nullptr, intercept);
+        if (output == 2) {
+            return eigen_to_fp(r.residuals);
+        }
+        if (output == 3) {
+            return eigen_to_fp(Y - r.residuals);
+        }
+
+        const Index p = r.coefficients.rows();
+        const Index m = output == 0 ? Y.rows() : 0;
+        _FP12* result = fp_alloc(3 * p + 4 + m, Y.cols());
+        auto R = fp_out(result);
+        R.topRows(p) = r.coefficients;
+        R.middleRows(p, p) = r.errors;
+        R.middleRows(2 * p, p) = r.coefficients.cwiseQuotient(r.errors);
+        R.row(3 * p) = r.r2;
+        R.row(3 * p + 1) = r.f;
+        R.row(3 * p + 2) = r.sigma;
+        R.row(3 * p + 3).setConstant(r.dof);
+        R.bottomRows(m) = r.residuals;
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
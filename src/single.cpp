@@ -0,0 +1,301 @@
+// ==============================================================================
+// single.cpp - Single-precision LINALG functions
+// ==============================================================================
+// MATRIX32.* functions narrow their arguments to float, run the Eigen kernels
+// on MatrixXf, and widen the results to double at the FP12 boundary. Float
+// kernels move half the bytes and fit twice as many lanes per SIMD register.
+// Expect about 7 significant digits.
+// ==============================================================================
+
+#include "factor.h"
+#include "cache.h"
+
+using namespace xll;
+using namespace Eigen;
+
+// ==============================================================================
+// Single-Precision Functions (7 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX32.MUL - Single-precision matrix multiplication
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_mul(
+    Function(XLL_FP, "xll_matrix32_mul", "MATRIX32.MUL")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the first matrix."),
+        Arg(XLL_FP, "B", "is the second matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Multiply matrices A and B in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes matrix multiplication in float: \[C = AB\]</p>
+<p><b>Input:</b> A(m×n) and B(n×p) - columns of A must equal rows of B</p>
+<p><b>Output:</b> Matrix C(m×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_mul(_FP12* pa, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->columns != pb->rows) {
+            return nullptr; // Dimension mismatch
+        }
+
+        const MatrixXf A = fp_to_float(pa);
+        const MatrixXf B = fp_to_float(pb);
+        const MatrixXf C = A * B;
+
+        return eigen_to_fp(C.cast<double>());
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.INVERSE - Single-precision matrix inverse
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_inv(
+    Function(XLL_FP, "xll_matrix32_inv", "MATRIX32.INVERSE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square invertible matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the inverse of a square matrix in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes matrix inverse in float: \[A^{-1}\]</p>
+<p><b>Input:</b> Invertible square matrix A(n×n)</p>
+<p><b>Output:</b> Inverse matrix A^-1(n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_inv(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->rows != pa->columns) {
+            return nullptr; // Not square
+        }
+
+        return cached(cache_id::inverse32, pa, [&] {
+            PartialPivLU<MatrixXf> lu(fp_to_float(pa));
+            const MatrixXf Ainv = lu.inverse();
+            return eigen_to_fp(Ainv.cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.CHOLESKY - Single-precision Cholesky decomposition
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_cholesky(
+    Function(XLL_FP, "xll_matrix32_cholesky", "MATRIX32.CHOLESKY")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a symmetric positive-definite matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute Cholesky decomposition of a SPD matrix in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes Cholesky decomposition in float: \[A = LL^T\]</p>
+<p>Matrices that are positive definite but close to singular in double may fail in float.</p>
+<p><b>Input:</b> Symmetric positive-definite matrix A(n×n)</p>
+<p><b>Output:</b> Lower triangular matrix L(n×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_cholesky(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->rows != pa->columns) {
+            return nullptr;
+        }
+
+        return cached(cache_id::cholesky32, pa, [&]() -> _FP12* {
+            LLT<MatrixXf> llt(fp_to_float(pa));
+            if (llt.info() != Success) {
+                return nullptr; // Not positive definite
+            }
+
+            const MatrixXf L = llt.matrixL();
+            return eigen_to_fp(L.cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.SVD - Single-precision singular values
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_svd(
+    Function(XLL_FP, "xll_matrix32_svd", "MATRIX32.SVD")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute singular values of a matrix in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes singular values in float using divide and conquer: \[A = U\Sigma V^T\]</p>
+<p><b>Input:</b> Matrix A(m×n)</p>
+<p><b>Output:</b> Column vector of singular values (min(m,n)×1)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_svd(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        return cached(cache_id::svd32, pa, [&] {
+            BDCSVD<MatrixXf> svd(fp_to_float(pa));
+            return vector_to_fp(svd.singularValues().cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.EIGENVALUES - Single-precision eigenvalues
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_eigenvalues(
+    Function(XLL_FP, "xll_matrix32_eigenvalues", "MATRIX32.EIGENVALUES")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute eigenvalues of a square matrix in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes eigenvalues in float: \[Av = \lambda v\]</p>
+<p>Returns real parts of eigenvalues (imaginary parts ignored).</p>
+<p><b>Input:</b> Square matrix A(n×n)</p>
+<p><b>Output:</b> Column vector of eigenvalues (n×1)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_eigenvalues(_FP12* pa)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->rows != pa->columns) {
+            return nullptr;
+        }
+
+        return cached(cache_id::eigenvalues32, pa, [&] {
+            EigenSolver<MatrixXf> es(fp_to_float(pa), false); // skip eigenvectors
+            return vector_to_fp(es.eigenvalues().real().cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.SOLVE - Single-precision linear solve
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_solve(
+    Function(XLL_FP, "xll_matrix32_solve", "MATRIX32.SOLVE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a square coefficient matrix."),
+        Arg(XLL_FP, "b", "is the right-hand side vector or matrix.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Solve linear system Ax = b in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Solves linear system in float: \[Ax = b\]</p>
+<p><b>Input:</b> A(n×n) coefficient matrix, b(n×1) or b(n×m) right-hand side</p>
+<p><b>Output:</b> Solution x(n×1) or x(n×m)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_solve(_FP12* pa, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->rows != pa->columns || pa->columns != pb->rows) {
+            return nullptr;
+        }
+
+        return cached(cache_id::solve32, pa, pb, [&] {
+            PartialPivLU<MatrixXf> lu(fp_to_float(pa));
+            const MatrixXf x = lu.solve(fp_to_float(pb));
+            return eigen_to_fp(x.cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX32.LSTSQ - Single-precision least squares
+// -----------------------------------------------------------------------------
+AddIn xai_matrix32_lstsq(
+    Function(XLL_FP, "xll_matrix32_lstsq", "MATRIX32.LSTSQ")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the coefficient matrix."),
+        Arg(XLL_FP, "b", "is the right-hand side vector.")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Solve overdetermined system in least squares sense in single precision.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes least squares solution in float: \[\min_x \|Ax - b\|_2\]</p>
+<p><b>Input:</b> A(m×n) coefficient matrix, b(m×1) right-hand side</p>
+<p><b>Output:</b> Solution x(n×1) minimizing residual</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix32_lstsq(_FP12* pa, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        if (pa->rows != pb->rows) {
+            return nullptr;
+        }
+
+        return cached(cache_id::lstsq32, pa, pb, [&] {
+            BDCSVD<MatrixXf, ComputeThinU | ComputeThinV> svd(fp_to_float(pa));
+            const MatrixXf x = svd.solve(fp_to_float(pb));
+            return eigen_to_fp(x.cast<double>());
+        });
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
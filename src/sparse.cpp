@@ -0,0 +1,638 @@
+// ==============================================================================
+// sparse.cpp - Sparse matrix handles and sparse direct solvers
+// ==============================================================================
+// \MATRIX.SPARSE and \MATRIX.SPARSE.FROM_DENSE return handles to sparse
+// matrices. \MATRIX.SPARSE.CHOL, \MATRIX.SPARSE.LU and \MATRIX.SPARSE.QR return
+// factorization handles usable by MATRIX.FACTOR.SOLVE and MATRIX.FACTOR.LOGDET.
+// ==============================================================================
+
+#include <cmath>
+#include <vector>
+#include "sparse.h"
+
+using namespace xll;
+using namespace Eigen;
+
+// ==============================================================================
+// Conversions
+// ==============================================================================
+
+sparse_matrix xll::sparse_from_triplets(const _FP12* triplets, Index rows, Index cols)
+{
+    auto T = fp_map(triplets);
+    ensure(T.cols() == 3);
+
+    std::vector<Triplet<double>> ijv;
+    ijv.reserve(static_cast<size_t>(T.rows()));
+
+    Index m = 0, n = 0;
+    for (Index k = 0; k < T.rows(); ++k) {
+        const double i = T(k, 0);
+        const double j = T(k, 1);
+        ensure(i >= 1 && i == std::floor(i));
+        ensure(j >= 1 && j == std::floor(j));
+
+        const Index i_ = static_cast<Index>(i) - 1;
+        const Index j_ = static_cast<Index>(j) - 1;
+        m = (std::max)(m, i_ + 1);
+        n = (std::max)(n, j_ + 1);
+
+        if (T(k, 2) != 0) {
+            ijv.emplace_back(i_, j_, T(k, 2));
+        }
+    }
+
+    if (rows == 0) {
+        rows = m;
+    }
+    if (cols == 0) {
+        cols = n;
+    }
+    ensure(rows >= m && cols >= n);
+
+    sparse_matrix A(rows, cols);
+    A.setFromTriplets(ijv.begin(), ijv.end()); // sums duplicates, result is compressed
+
+    return A;
+}
+
+sparse_matrix xll::sparse_from_dense(const Eigen::Ref<const RowMatrixXd>& A, double tol)
+{
+    ensure(tol >= 0);
+
+    std::vector<Triplet<double>> ijv;
+    for (Index i = 0; i < A.rows(); ++i) {
+        for (Index j = 0; j < A.cols(); ++j) {
+            if (std::fabs(A(i, j)) > tol) {
+                ijv.emplace_back(i, j, A(i, j));
+            }
+        }
+    }
+
+    sparse_matrix S(A.rows(), A.cols());
+    S.setFromTriplets(ijv.begin(), ijv.end());
+
+    return S;
+}
+
+_FP12* xll::sparse_to_triplets(const sparse_matrix& A)
+{
+    if (A.nonZeros() == 0) {
+        return nullptr;
+    }
+
+    _FP12* result = fp_alloc(A.nonZeros(), 3);
+    auto T = fp_out(result);
+
+    Index k = 0;
+    for (Index j = 0; j < A.outerSize(); ++j) {
+        for (sparse_matrix::InnerIterator a(A, j); a; ++a, ++k) {
+            T(k, 0) = static_cast<double>(a.row() + 1);
+            T(k, 1) = static_cast<double>(a.col() + 1);
+            T(k, 2) = a.value();
+        }
+    }
+
+    return result;
+}
+
+// ==============================================================================
+// Sparse Factorization Implementations
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// Cholesky
+// -----------------------------------------------------------------------------
+
+sparse_chol_factor::sparse_chol_factor(const sparse_matrix& A)
+{
+    ensure(A.rows() == A.cols());
+
+    llt.compute(A);
+    ensure(llt.info() == Success); // positive definite
+}
+
+Index sparse_chol_factor::rows() const
+{
+    return llt.rows();
+}
+
+Index sparse_chol_factor::cols() const
+{
+    return llt.cols();
+}
+
+MatrixXd sparse_chol_factor::solve(const MatrixXd& b) const
+{
+    return llt.solve(b);
+}
+
+MatrixXd sparse_chol_factor::U() const
+{
+    return MatrixXd();
+}
+
+MatrixXd sparse_chol_factor::V() const
+{
+    return MatrixXd();
+}
+
+VectorXd sparse_chol_factor::values() const
+{
+    // Diagonal of L in the permuted ordering
+    return llt.matrixL().nestedExpression().diagonal();
+}
+
+double sparse_chol_factor::logdet() const
+{
+    return 2 * values().array().log().sum();
+}
+
+// -----------------------------------------------------------------------------
+// LU
+// -----------------------------------------------------------------------------
+
+sparse_lu_factor::sparse_lu_factor(const sparse_matrix& A)
+{
+    ensure(A.rows() == A.cols());
+    ensure(A.isCompressed());
+
+    lu.compute(A);
+    ensure(lu.info() == Success); // nonsingular
+}
+
+Index sparse_lu_factor::rows() const
+{
+    return lu.rows();
+}
+
+Index sparse_lu_factor::cols() const
+{
+    return lu.cols();
+}
+
+MatrixXd sparse_lu_factor::solve(const MatrixXd& b) const
+{
+    return lu.solve(b);
+}
+
+MatrixXd sparse_lu_factor::U() const
+{
+    return MatrixXd();
+}
+
+MatrixXd sparse_lu_factor::V() const
+{
+    return MatrixXd();
+}
+
+VectorXd sparse_lu_factor::values() const
+{
+    // Supernodal U has no direct diagonal accessor
+    return VectorXd();
+}
+
+double sparse_lu_factor::logdet() const
+{
+    return lu.logAbsDeterminant();
+}
+
+// -----------------------------------------------------------------------------
+// QR
+// -----------------------------------------------------------------------------
+
+sparse_qr_factor::sparse_qr_factor(const sparse_matrix& A)
+{
+    ensure(A.isCompressed());
+
+    qr.compute(A);
+    ensure(qr.info() == Success);
+}
+
+Index sparse_qr_factor::rows() const
+{
+    return qr.rows();
+}
+
+Index sparse_qr_factor::cols() const
+{
+    return qr.cols();
+}
+
+MatrixXd sparse_qr_factor::solve(const MatrixXd& b) const
+{
+    return qr.solve(b);
+}
+
+MatrixXd sparse_qr_factor::U() const
+{
+    return MatrixXd();
+}
+
+MatrixXd sparse_qr_factor::V() const
+{
+    return MatrixXd();
+}
+
+VectorXd sparse_qr_factor::values() const
+{
+    // Diagonal of R in the column permuted ordering
+    return qr.matrixR().diagonal();
+}
+
+double sparse_qr_factor::logdet() const
+{
+    return values().array().abs().log().sum();
+}
+
+// ==============================================================================
+// Sparse Matrix Constructors (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE - Sparse matrix from triplets
+// -----------------------------------------------------------------------------
+AddIn xai_sparse(
+    Function(XLL_HANDLEX, "xll_sparse", "\\MATRIX.SPARSE")
+    .Arguments({
+        Arg(XLL_FP, "triplets", "is a k×3 array of 1-based row, column, and value."),
+        Arg(XLL_DOUBLE, "rows", "is the optional number of rows. Default is the largest row index."),
+        Arg(XLL_DOUBLE, "cols", "is the optional number of columns. Default is the largest column index.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a sparse matrix built from (row, column, value) triplets.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Builds a compressed column sparse matrix. Entries with the same row and column are summed.</p>
+<p>Storage is O(nnz), independent of the matrix dimensions.</p>
+<p><b>Input:</b> Triplets (k×3), optional dimensions m and n</p>
+<p><b>Output:</b> Handle to the sparse matrix S(m×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse(_FP12* pt, double m, double n)
+{
+#pragma XLLEXPORT
+    try {
+        ensure(m >= 0 && n >= 0);
+
+        handle<sparse_matrix> h(new sparse_matrix(
+            sparse_from_triplets(pt, static_cast<Index>(m), static_cast<Index>(n))));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE.FROM_DENSE - Sparse matrix from a dense array
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_from_dense(
+    Function(XLL_HANDLEX, "xll_sparse_from_dense", "\\MATRIX.SPARSE.FROM_DENSE")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the dense matrix."),
+        Arg(XLL_DOUBLE, "tol", "is the optional drop tolerance. Default is 0.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a sparse matrix keeping entries of A with |a| > tol.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Builds a compressed column sparse matrix from the entries of A larger than tol in absolute value.</p>
+<p><b>Input:</b> Matrix A(m×n), drop tolerance tol ≥ 0</p>
+<p><b>Output:</b> Handle to the sparse matrix S(m×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse_from_dense(_FP12* pa, double tol)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> h(new sparse_matrix(sparse_from_dense(fp_map(pa), tol)));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE.MUL - Sparse matrix product
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_mul_handle(
+    Function(XLL_HANDLEX, "xll_sparse_mul_handle", "\\MATRIX.SPARSE.MUL")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle returned by \\MATRIX.SPARSE."),
+        Arg(XLL_HANDLEX, "B", "is a handle returned by \\MATRIX.SPARSE.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a handle to the sparse product of two sparse matrices.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes sparse matrix product: \[C = AB\]</p>
+<p>Cost is proportional to the number of nonzero products, not m·n·p.</p>
+<p><b>Input:</b> Sparse handles A(m×n), B(n×p)</p>
+<p><b>Output:</b> Handle to the sparse matrix C(m×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse_mul_handle(HANDLEX _a, HANDLEX _b)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        handle<sparse_matrix> b(_b);
+        ensure(a && b && a->cols() == b->rows());
+
+        handle<sparse_matrix> h(new sparse_matrix(*a * *b));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// ==============================================================================
+// Sparse Matrix Accessors (4 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.SPARSE.MUL - Sparse times dense product
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_mul(
+    Function(XLL_FP, "xll_sparse_mul", "MATRIX.SPARSE.MUL")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle returned by \\MATRIX.SPARSE."),
+        Arg(XLL_FP, "B", "is a dense vector or matrix.")
+    })
+    .FunctionHelp("Multiply a sparse matrix by a dense vector or matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes sparse matrix-vector or matrix-matrix product: \[C = AB\]</p>
+<p>Cost is O(nnz(A)·p).</p>
+<p><b>Input:</b> Sparse handle A(m×n), dense B(n×p)</p>
+<p><b>Output:</b> Dense matrix C(m×p)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_sparse_mul(HANDLEX _a, _FP12* pb)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        auto B = fp_map(pb);
+
+        if (!a || a->cols() != B.rows()) {
+            return nullptr;
+        }
+
+        _FP12* C = fp_alloc(a->rows(), B.cols());
+        fp_out(C).noalias() = *a * B;
+
+        return C;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SPARSE.TRIPLETS - Export nonzeros
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_triplets(
+    Function(XLL_FP, "xll_sparse_triplets", "MATRIX.SPARSE.TRIPLETS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle returned by \\MATRIX.SPARSE.")
+    })
+    .FunctionHelp("Return the nonzeros of a sparse matrix as (row, column, value) triplets.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Returns the stored entries in column order. Passing the result to \MATRIX.SPARSE
+reproduces the matrix.</p>
+<p><b>Input:</b> Sparse handle A</p>
+<p><b>Output:</b> 1-based triplets (nnz×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_sparse_triplets(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+
+        return a ? sparse_to_triplets(*a) : nullptr;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SPARSE.DENSE - Expand to a dense array
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_dense(
+    Function(XLL_FP, "xll_sparse_dense", "MATRIX.SPARSE.DENSE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle returned by \\MATRIX.SPARSE.")
+    })
+    .FunctionHelp("Return a sparse matrix as a dense array.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Expands the sparse matrix with explicit zeros. Intended for inspecting small matrices.</p>
+<p><b>Input:</b> Sparse handle A(m×n)</p>
+<p><b>Output:</b> Dense matrix A(m×n)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_sparse_dense(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        if (!a) {
+            return nullptr;
+        }
+
+        _FP12* result = fp_alloc(a->rows(), a->cols());
+        fp_out(result) = *a;
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.SPARSE.SIZE - Dimensions and number of nonzeros
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_size(
+    Function(XLL_FP, "xll_sparse_size", "MATRIX.SPARSE.SIZE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle returned by \\MATRIX.SPARSE.")
+    })
+    .FunctionHelp("Return rows, columns, and number of nonzeros of a sparse matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p><b>Input:</b> Sparse handle A(m×n)</p>
+<p><b>Output:</b> Row vector {m, n, nnz} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_sparse_size(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        if (!a) {
+            return nullptr;
+        }
+
+        const double size[3] = {
+            static_cast<double>(a->rows()),
+            static_cast<double>(a->cols()),
+            static_cast<double>(a->nonZeros())
+        };
+
+        return row_vector_to_fp(Map<const VectorXd>(size, 3));
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// ==============================================================================
+// Sparse Factorization Constructors (3 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE.CHOL - Sparse Cholesky factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_chol(
+    Function(XLL_HANDLEX, "xll_sparse_chol", "\\MATRIX.SPARSE.CHOL")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle to a symmetric positive-definite sparse matrix.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a factorization handle for the sparse Cholesky decomposition.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes simplicial Cholesky decomposition with fill-reducing ordering: \[PAP^T = LL^T\]</p>
+<p>Only the lower triangle of A is used. Use MATRIX.FACTOR.SOLVE and MATRIX.FACTOR.LOGDET on the result.</p>
+<p><b>Input:</b> Sparse handle A(n×n)</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse_chol(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        ensure(a);
+
+        handle<factor> h(new sparse_chol_factor(*a));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE.LU - Sparse LU factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_lu(
+    Function(XLL_HANDLEX, "xll_sparse_lu", "\\MATRIX.SPARSE.LU")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle to a square sparse matrix.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a factorization handle for the sparse LU decomposition.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes supernodal LU decomposition with fill-reducing column ordering: \[P_rAP_c = LU\]</p>
+<p>Use MATRIX.FACTOR.SOLVE and MATRIX.FACTOR.LOGDET on the result.</p>
+<p><b>Input:</b> Sparse handle A(n×n)</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse_lu(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        ensure(a);
+
+        handle<factor> h(new sparse_lu_factor(*a));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// \MATRIX.SPARSE.QR - Sparse QR factorization handle
+// -----------------------------------------------------------------------------
+AddIn xai_sparse_qr(
+    Function(XLL_HANDLEX, "xll_sparse_qr", "\\MATRIX.SPARSE.QR")
+    .Arguments({
+        Arg(XLL_HANDLEX, "A", "is a handle to a sparse matrix.")
+    })
+    .Uncalced()
+    .FunctionHelp("Return a factorization handle for the sparse QR decomposition.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes QR decomposition with fill-reducing column ordering: \[AP = QR\]</p>
+<p>MATRIX.FACTOR.SOLVE returns the least squares solution for m ≥ n.</p>
+<p><b>Input:</b> Sparse handle A(m×n)</p>
+<p><b>Output:</b> Handle to the factorization</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+HANDLEX WINAPI xll_sparse_qr(HANDLEX _a)
+{
+#pragma XLLEXPORT
+    try {
+        handle<sparse_matrix> a(_a);
+        ensure(a);
+
+        handle<factor> h(new sparse_qr_factor(*a));
+        return h.get();
+    }
+    catch (...) {
+        return INVALID_HANDLEX;
+    }
+}
@@ -0,0 +1,379 @@
+// ==============================================================================
+// topk.cpp - Truncated SVD and eigendecompositions
+// ==============================================================================
+// MATRIX.SVD.TOPK and MATRIX.EIG.TOPK return the leading k singular triplets or
+// eigenpairs together with an accuracy report.
+// ==============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "topk.h"
+
+// Suppress warnings from Eigen library headers (external code)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#elif defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wnull-dereference"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4996)
+#endif
+
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+#include <Eigen/SVD>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#elif defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+using namespace xll;
+using namespace Eigen;
+
+// ==============================================================================
+// Algorithms
+// ==============================================================================
+
+namespace {
+
+    // Seed argument as an unsigned integer. Converting a negative or out of
+    // range double is undefined, so those are rejected.
+    uint64_t to_seed(double seed)
+    {
+        ensure(seed >= 0 && seed < 0x1p64 && seed == std::floor(seed));
+
+        return static_cast<uint64_t>(seed);
+    }
+
+    // Standard normal test matrix
+    MatrixXd gaussian(Index rows, Index cols, std::mt19937_64& gen)
+    {
+        std::normal_distribution<double> N;
+        MatrixXd Omega(rows, cols);
+        for (Index j = 0; j < cols; ++j) {
+            for (Index i = 0; i < rows; ++i) {
+                Omega(i, j) = N(gen);
+            }
+        }
+
+        return Omega;
+    }
+
+    // Orthonormal basis for the range of Y
+    MatrixXd orth(const MatrixXd& Y)
+    {
+        HouseholderQR<MatrixXd> qr(Y);
+
+        return qr.householderQ() * MatrixXd::Identity(Y.rows(), Y.cols());
+    }
+
+    // Indices of the k entries of x largest in absolute value
+    std::vector<Index> top_abs(const VectorXd& x, Index k)
+    {
+        std::vector<Index> i(static_cast<size_t>(x.size()));
+        std::iota(i.begin(), i.end(), Index(0));
+        std::stable_sort(i.begin(), i.end(), [&x](Index a, Index b) {
+            return std::fabs(x(a)) > std::fabs(x(b));
+        });
+        i.resize(static_cast<size_t>(k));
+
+        return i;
+    }
+
+    // Select eigenpairs of B = W diag(θ) W^T and map them back through Q
+    truncated_eig select(const VectorXd& theta, const MatrixXd& W, const MatrixXd& Q, Index k)
+    {
+        const auto i = top_abs(theta, k);
+
+        truncated_eig eig;
+        eig.values = theta(i);
+        eig.vectors = Q * W(all, i);
+
+        return eig;
+    }
+
+} // namespace
+
+truncated_svd xll::randomized_svd(const Eigen::Ref<const RowMatrixXd>& A, Index k,
+    uint64_t seed, int power, Index oversample)
+{
+    const Index r = (std::min)(A.rows(), A.cols());
+    ensure(k >= 1 && k <= r);
+
+    std::mt19937_64 gen(seed);
+    const Index l = (std::min)(k + oversample, r);
+
+    // Range of A (A^T A)^q Ω
+    MatrixXd Q = orth(A * gaussian(A.cols(), l, gen));
+    for (int q = 0; q < power; ++q) {
+        Q = orth(A * orth(A.transpose() * Q));
+    }
+
+    // SVD of the small l×n projection B = Q^T A
+    const MatrixXd B = Q.transpose() * A;
+    BDCSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(B);
+
+    truncated_svd result;
+    result.U = Q * svd.matrixU().leftCols(k);
+    result.s = svd.singularValues().head(k);
+    result.V = svd.matrixV().leftCols(k);
+
+    return result;
+}
+
+truncated_eig xll::randomized_eig(const Eigen::Ref<const RowMatrixXd>& A, Index k,
+    uint64_t seed, int power, Index oversample)
+{
+    const Index n = A.rows();
+    ensure(A.cols() == n && k >= 1 && k <= n);
+
+    std::mt19937_64 gen(seed);
+    const Index l = (std::min)(k + oversample, n);
+
+    MatrixXd Q = orth(A * gaussian(n, l, gen));
+    for (int q = 0; q < power; ++q) {
+        Q = orth(A * Q);
+    }
+
+    // Rayleigh-Ritz on the l×l projection Q^T A Q
+    MatrixXd B = Q.transpose() * A * Q;
+    B = (B + B.transpose()) / 2;
+    SelfAdjointEigenSolver<MatrixXd> es(B);
+
+    return select(es.eigenvalues(), es.eigenvectors(), Q, k);
+}
+
+truncated_eig xll::lanczos_eig(const Eigen::Ref<const RowMatrixXd>& A, Index k,
+    uint64_t seed, double tol)
+{
+    const Index n = A.rows();
+    ensure(A.cols() == n && k >= 1 && k <= n);
+
+    std::mt19937_64 gen(seed);
+    const auto start = [&](const MatrixXd& Q, Index m) {
+        // Random unit vector orthogonal to the first m Lanczos vectors
+        VectorXd q = gaussian(n, 1, gen);
+        for (int pass = 0; pass < 2; ++pass) {
+            q -= Q.leftCols(m) * (Q.leftCols(m).transpose() * q);
+        }
+
+        return VectorXd(q.normalized());
+    };
+
+    Index cap = (std::min)(n, (std::max)(2 * k, k + 20));
+    MatrixXd Q(n, cap);
+    VectorXd alpha(cap), beta(cap);
+    Q.col(0) = start(Q, 0);
+
+    VectorXd w;
+    double scale = 0;
+    for (Index j = 0; ; ++j) {
+        const Index m = j + 1;
+
+        w.noalias() = A * Q.col(j);
+        alpha(j) = Q.col(j).dot(w);
+        // Full reorthogonalization, twice is enough
+        for (int pass = 0; pass < 2; ++pass) {
+            w -= Q.leftCols(m) * (Q.leftCols(m).transpose() * w);
+        }
+        beta(j) = w.norm();
+        scale = (std::max)(scale, std::fabs(alpha(j)) + beta(j));
+        const bool breakdown = beta(j) <= std::numeric_limits<double>::epsilon() * scale;
+
+        if (m >= k && (m == n || !breakdown)) {
+            SelfAdjointEigenSolver<MatrixXd> es;
+            es.computeFromTridiagonal(alpha.head(m), beta.head(m - 1), ComputeEigenvectors);
+
+            // Ritz residual ||A x - θ x|| = β_j |s_{m-1}|
+            const auto i = top_abs(es.eigenvalues(), k);
+            const double theta = std::fabs(es.eigenvalues()(i[0]));
+            bool converged = m == n;
+            for (Index l = 0; !converged && l < k; ++l) {
+                if (beta(j) * std::fabs(es.eigenvectors()(m - 1, i[l])) > tol * theta) {
+                    break;
+                }
+                converged = l == k - 1;
+            }
+
+            if (converged) {
+                return select(es.eigenvalues(), es.eigenvectors(), Q.leftCols(m), k);
+            }
+        }
+
+        if (m == cap) {
+            cap = (std::min)(n, 2 * cap);
+            Q.conservativeResize(NoChange, cap);
+            alpha.conservativeResize(cap);
+            beta.conservativeResize(cap);
+        }
+
+        if (breakdown) {
+            // Invariant subspace found, continue in its orthogonal complement
+            beta(j) = 0;
+            Q.col(m) = start(Q, m);
+        }
+        else {
+            Q.col(m) = w / beta(j);
+        }
+    }
+}
+
+// ==============================================================================
+// Excel Functions (2 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.SVD.TOPK - Truncated singular value decomposition
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_svd_topk(
+    Function(XLL_FP, "xll_matrix_svd_topk", "MATRIX.SVD.TOPK")
+    .Arguments({
+        Arg(XLL_FP, "A", "is the matrix."),
+        Arg(XLL_DOUBLE, "k", "is the number of singular values."),
+        Arg(XLL_DOUBLE, "seed", "is the optional nonnegative integer random seed. Default is 0."),
+        Arg(XLL_LPOPER, "power", "is the optional number of power iterations. Default is 2."),
+        Arg(XLL_LPOPER, "method", "is the optional method \"RANDOMIZED\" or \"LANCZOS\" for symmetric A. Default is \"RANDOMIZED\".")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the k largest singular values and vectors of a matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes truncated singular value decomposition: \[A \approx U_k\Sigma_k V_k^T\]</p>
+<p>RANDOMIZED projects A onto the range of A(A^TA)^qΩ for a Gaussian Ω with k + 10
+columns, in O(mnk) time. More power iterations q improve accuracy when singular
+values decay slowly. LANCZOS requires symmetric A, returns an error otherwise,
+and uses |λ| of the largest magnitude eigenvalues.</p>
+<p>The accuracy report gives \[\|A - U_j\Sigma_j V_j^T\|_F / \|A\|_F\] for each rank j = 1, ..., k.</p>
+<p><b>Input:</b> Matrix A(m×n), rank k ≤ min(m,n)</p>
+<p><b>Output:</b> Stacked matrix with σ (1×k), U_k (m×k), V_k (n×k), and accuracy report (1×k)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_svd_topk(_FP12* pa, double k, double seed, LPOPER ppower, LPOPER pmethod)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+        const Index k_ = to_index(k);
+        const int power = option(*ppower, {}, 2);
+        const int method = option(*pmethod, { "RANDOMIZED", "LANCZOS" }, 0);
+
+        if (k_ < 1 || k_ > (std::min)(A.rows(), A.cols()) || power < 0 || method < 0 || method > 1) {
+            return nullptr;
+        }
+        const uint64_t seed_ = to_seed(seed);
+
+        truncated_svd svd;
+        if (method == 0) {
+            svd = randomized_svd(A, k_, seed_, power);
+        }
+        else {
+            if (A.rows() != A.cols() || !A.isApprox(A.transpose())) {
+                return nullptr;
+            }
+
+            // A = X Λ X^T so U = X, Σ = |Λ|, V = X sign(Λ)
+            const truncated_eig eig = lanczos_eig(A, k_, seed_);
+            svd.U = eig.vectors;
+            svd.s = eig.values.cwiseAbs();
+            svd.V = eig.vectors * eig.values.array().sign().matrix().asDiagonal();
+        }
+
+        const Index m = A.rows();
+        const Index n = A.cols();
+        _FP12* result = fp_alloc(1 + m + n + 1, k_);
+        auto R = fp_out(result);
+
+        R.row(0) = svd.s.transpose();
+        R.middleRows(1, m) = svd.U;
+        R.middleRows(1 + m, n) = svd.V;
+
+        // ||A - A_j||_F^2 = ||A||_F^2 - σ_1^2 - ... - σ_j^2
+        const double norm2 = A.squaredNorm();
+        double tail = norm2;
+        for (Index j = 0; j < k_; ++j) {
+            tail -= svd.s(j) * svd.s(j);
+            R(1 + m + n, j) = norm2 > 0 ? std::sqrt((std::max)(tail, 0.) / norm2) : 0;
+        }
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.EIG.TOPK - Largest eigenpairs of a symmetric matrix
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_eig_topk(
+    Function(XLL_FP, "xll_matrix_eig_topk", "MATRIX.EIG.TOPK")
+    .Arguments({
+        Arg(XLL_FP, "A", "is a symmetric matrix."),
+        Arg(XLL_DOUBLE, "k", "is the number of eigenvalues."),
+        Arg(XLL_DOUBLE, "seed", "is the optional nonnegative integer random seed. Default is 0."),
+        Arg(XLL_LPOPER, "method", "is the optional method \"LANCZOS\" or \"RANDOMIZED\". Default is \"LANCZOS\".")
+    })
+    .ThreadSafe()
+    .FunctionHelp("Compute the k largest magnitude eigenvalues and eigenvectors of a symmetric matrix.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Computes eigenpairs \[Ax = \lambda x\] for the k eigenvalues of largest magnitude.
+Both methods assume A is symmetric and return an error if it is not.</p>
+<p>LANCZOS builds a Krylov basis with full reorthogonalization until the Ritz
+residuals are below 1e-10|λ_1|. RANDOMIZED uses a Gaussian range finder with
+k + 10 columns and 2 power iterations.</p>
+<p>The accuracy report gives \[\|Ax_j - \lambda_j x_j\| / |\lambda_1|\] for each eigenpair.</p>
+<p><b>Input:</b> Symmetric matrix A(n×n), k ≤ n</p>
+<p><b>Output:</b> Stacked matrix with λ (1×k), eigenvectors X (n×k), and accuracy report (1×k)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_eig_topk(_FP12* pa, double k, double seed, LPOPER pmethod)
+{
+#pragma XLLEXPORT
+    try {
+        auto A = fp_map(pa);
+        const Index n = A.rows();
+        const Index k_ = to_index(k);
+        const int method = option(*pmethod, { "LANCZOS", "RANDOMIZED" }, 0);
+
+        if (A.cols() != n || k_ < 1 || k_ > n || method < 0 || method > 1 || !A.isApprox(A.transpose())) {
+            return nullptr;
+        }
+
+        const truncated_eig eig = method == 0
+            ? lanczos_eig(A, k_, to_seed(seed))
+            : randomized_eig(A, k_, to_seed(seed));
+
+        _FP12* result = fp_alloc(1 + n + 1, k_);
+        auto R = fp_out(result);
+
+        R.row(0) = eig.values.transpose();
+        R.middleRows(1, n) = eig.vectors;
+
+        const MatrixXd residual = A * eig.vectors - eig.vectors * eig.values.asDiagonal();
+        const double scale = eig.values(0) != 0 ? std::fabs(eig.values(0)) : 1;
+        R.row(1 + n) = residual.colwise().norm() / scale;
+
+        return result;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,308 @@
+// ==============================================================================
+// tune.cpp - Kernel autotuner
+// ==============================================================================
+// Each crossover is the smallest tested size from which the second candidate
+// is faster at that size and the next, so timing noise at one size does not
+// flip the choice.
+// ==============================================================================
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <string>
+#include "tune.h"
+#include "async.h"
+
+using namespace xll;
+using namespace Eigen;
+
+namespace {
+
+    struct threshold {
+        const char* name;
+        std::atomic<Index>& value;
+    };
+
+    std::vector<threshold> thresholds()
+    {
+        auto& t = linalg_thresholds();
+
+        return {
+            { "svd_divide_conquer", t.svd_divide_conquer },
+            { "gemm_parallel", t.gemm_parallel },
+            { "band_ratio", t.band_ratio },
+        };
+    }
+
+    // Fastest of a few runs in seconds
+    template<class F>
+    double best_time(F&& f, int runs = 3)
+    {
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < runs; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = (std::min)(best, elapsed.count());
+        }
+
+        return best;
+    }
+
+    // Index of the first size from which second(n) beats first(n) twice in a row,
+    // or sizes.size() if it never does
+    template<class F, class G>
+    size_t crossover(const std::vector<Index>& sizes, F&& first, G&& second)
+    {
+        size_t wins = 0;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            if (best_time([&] { second(sizes[i]); }) < best_time([&] { first(sizes[i]); })) {
+                if (++wins == 2) {
+                    return i - 1;
+                }
+            }
+            else {
+                wins = 0;
+            }
+        }
+
+        return wins ? sizes.size() - 1 : sizes.size();
+    }
+
+    // min(m,n) from which BDCSVD beats JacobiSVD with thin U and V
+    Index tune_svd()
+    {
+        const std::vector<Index> sizes = { 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+        MatrixXd A;
+
+        const size_t i = crossover(sizes,
+            [&](Index n) {
+                A = MatrixXd::Random(n, n);
+                JacobiSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
+            },
+            [&](Index n) {
+                A = MatrixXd::Random(n, n);
+                BDCSVD<MatrixXd, ComputeThinU | ComputeThinV> svd(A);
+            });
+
+        return i < sizes.size() ? sizes[i] : 2 * sizes.back();
+    }
+
+    // m·n·k from which the row-split GEMM of MATRIX.MUL beats a single thread
+    Index tune_gemm()
+    {
+        const std::vector<Index> sizes = { 32, 48, 64, 96, 128, 192, 256 };
+        RowMatrixXd A, B, C;
+        const auto setup = [&](Index n) {
+            if (A.rows() != n) {
+                A = RowMatrixXd::Random(n, n);
+                B = RowMatrixXd::Random(n, n);
+                C.resize(n, n);
+            }
+        };
+
+        const size_t i = crossover(sizes,
+            [&](Index n) {
+                setup(n);
+                C.noalias() = A * B;
+            },
+            [&](Index n) {
+                setup(n);
+                parallel_for(n, 16, [&](Index r, Index s) {
+                    C.middleRows(r, s - r).noalias() = A.middleRows(r, s - r) * B;
+                });
+            });
+
+        return i < sizes.size() ? sizes[i] * sizes[i] * sizes[i] : std::numeric_limits<Index>::max();
+    }
+
+    // n / (2·kl + ku + 1) from which band LU beats dense LU
+    Index tune_band()
+    {
+        const Index n = 384;
+        // Widths from wide to narrow so the crossover is where band LU starts winning
+        const std::vector<Index> widths = { 64, 48, 32, 24, 16, 8, 4, 2 };
+        RowMatrixXd A;
+        Index width = 0;
+        const auto setup = [&](Index k) {
+            if (width != k) {
+                A = RowMatrixXd::Random(n, n);
+                for (Index i = 0; i < n; ++i) {
+                    for (Index j = 0; j < n; ++j) {
+                        if (std::abs(i - j) > k) {
+                            A(i, j) = 0;
+                        }
+                    }
+                }
+                width = k;
+            }
+        };
+
+        const size_t i = crossover(widths,
+            [&](Index k) {
+                setup(k);
+                PartialPivLU<MatrixXd> lu(A);
+            },
+            [&](Index k) {
+                setup(k);
+                band_lu lu(A, k, k);
+            });
+
+        return i < widths.size() ? (n + 3 * widths[i]) / (3 * widths[i] + 1) : n;
+    }
+
+} // namespace
+
+void xll::autotune()
+{
+    auto& t = linalg_thresholds();
+
+    t.svd_divide_conquer = tune_svd();
+    t.gemm_parallel = tune_gemm();
+    t.band_ratio = tune_band();
+}
+
+std::filesystem::path xll::thresholds_file()
+{
+    return std::filesystem::path(std::wstring(view(AddInInfo::GetName()))).replace_extension(L".tune");
+}
+
+bool xll::load_thresholds(const std::filesystem::path& file)
+{
+    std::ifstream in(file);
+    if (!in) {
+        return false;
+    }
+
+    // Parse every entry before storing any so a bad file changes nothing
+    auto table = thresholds();
+    std::vector<Index> values(table.size(), 0);
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto eq = line.find('=');
+        if (line.empty() || line[0] == '#' || eq == std::string::npos) {
+            continue;
+        }
+        for (size_t i = 0; i < table.size(); ++i) {
+            if (line.compare(0, eq, table[i].name) == 0) {
+                const char* first = line.data() + eq + 1;
+                const char* last = line.data() + line.find_last_not_of(" \t\r") + 1;
+                Index value = 0;
+                const auto [end, ec] = std::from_chars(first, last, value);
+                if (ec != std::errc() || end != last || value <= 0) {
+                    return false;
+                }
+                values[i] = value;
+            }
+        }
+    }
+    for (Index value : values) {
+        if (value == 0) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i].value = values[i];
+    }
+
+    return true;
+}
+
+bool xll::save_thresholds(const std::filesystem::path& file)
+{
+    std::ofstream out(file);
+    out << "# xll_math kernel crossovers measured by MATRIX.TUNE\n";
+    for (const auto& t : thresholds()) {
+        out << t.name << '=' << t.value.load() << '\n';
+    }
+
+    return static_cast<bool>(out);
+}
+
+// Read saved crossovers or measure them on first load
+Auto<OpenAfter> xao_autotune([]() {
+    try {
+        const auto file = thresholds_file();
+        if (!load_thresholds(file)) {
+            autotune();
+            save_thresholds(file);
+        }
+    }
+    catch (...) {
+        // keep the defaults
+    }
+
+    return TRUE;
+});
+
+// ==============================================================================
+// Autotuner Functions (2 functions)
+// ==============================================================================
+
+// -----------------------------------------------------------------------------
+// MATRIX.TUNE - Remeasure kernel crossovers
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_tune(
+    Macro("xll_matrix_tune", "MATRIX.TUNE")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+int WINAPI xll_matrix_tune(void)
+{
+#pragma XLLEXPORT
+    try {
+        autotune();
+        save_thresholds(thresholds_file());
+    }
+    catch (...) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// -----------------------------------------------------------------------------
+// MATRIX.THRESHOLDS - Kernel crossovers in use
+// -----------------------------------------------------------------------------
+AddIn xai_matrix_thresholds(
+    Function(XLL_FP, "xll_matrix_thresholds", "MATRIX.THRESHOLDS")
+    .ThreadSafe()
+    .Volatile()
+    .FunctionHelp("Return the sizes at which LINALG functions switch kernels.")
+    .Category("LINALG")
+    .Documentation(R"(
+<p>Crossovers are measured the first time the add-in is loaded and saved to a
+.tune file next to it. Delete the file or run the MATRIX.TUNE macro to
+remeasure.</p>
+<p><b>svd_divide_conquer</b>: min(m,n) from which MATRIX.SVD, MATRIX.SVD_FULL,
+MATRIX.LSTSQ and MATRIX.PSEUDO_INV use BDCSVD instead of JacobiSVD</p>
+<p><b>gemm_parallel</b>: m·n·k from which MATRIX.MUL splits rows across the worker pool</p>
+<p><b>band_ratio</b>: n / (2·kl + ku + 1) from which MATRIX.SOLVE and
+MATRIX.DETERMINANT use band LU</p>
+<p><b>Output:</b> Row vector {svd_divide_conquer, gemm_parallel, band_ratio} (1×3)</p>
+)")
+);
+
+#if defined(__GNUC__) || defined(__clang__)
+extern "C"
+#endif
+_FP12* WINAPI xll_matrix_thresholds(void)
+{
+#pragma XLLEXPORT
+    try {
+        const auto table = thresholds();
+        VectorXd values(table.size());
+        for (size_t i = 0; i < table.size(); ++i) {
+            values(i) = static_cast<double>(table[i].value.load());
+        }
+
+        return row_vector_to_fp(values);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
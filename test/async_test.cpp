@@ -0,0 +1,348 @@
+// ==============================================================================
+// async_test.cpp - Worker pool and asynchronous calls without Excel
+// ==============================================================================
+// Results that would go to Excel with xlAsyncReturn are recorded per handle,
+// first through a replacement async_return and then through the Excel12v
+// stand-in. Every handle must receive exactly one correct result, whether its
+// request was queued, coalesced with an identical one in flight, computed
+// separately after a key collision, or run inline because the pool was full or
+// stopped by xlAutoClose.
+// ==============================================================================
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "async.h"
+#include "excel.h"
+
+using namespace xll;
+using namespace std::chrono_literals;
+
+// Kernels from linalg.cpp and async.cpp
+extern "C" {
+_FP12* WINAPI xll_matrix_inv(_FP12* pa);
+void WINAPI xll_matrix_inv_async(_FP12* pa, LPOPER phandle);
+}
+
+namespace {
+
+    int failures = 0;
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            ++failures;
+            std::fprintf(stderr, "failed: %s\n", what);
+        }
+    }
+
+    // Blocks tasks until opened
+    class gate {
+        std::mutex mutex;
+        std::condition_variable opened;
+        bool open = false;
+    public:
+        void wait()
+        {
+            std::unique_lock lock(mutex);
+            opened.wait(lock, [this] { return open; });
+        }
+        void release()
+        {
+            {
+                std::lock_guard lock(mutex);
+                open = true;
+            }
+            opened.notify_all();
+        }
+    };
+
+    // Wait up to 10 seconds for done()
+    template<class F>
+    bool eventually(F&& done)
+    {
+        const auto until = std::chrono::steady_clock::now() + 10s;
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > until) {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+
+        return true;
+    }
+
+    // Results delivered to each handle, keyed by the handle number
+    std::mutex returned_mutex;
+    std::map<int, std::vector<OPER>> returned;
+
+    void record(const XLOPER12& handle, const XLOPER12& result)
+    {
+        std::lock_guard lock(returned_mutex);
+        returned[static_cast<int>(handle.val.num)].emplace_back(result);
+    }
+
+    // Asynchronous call handle numbered h
+    OPER async_handle(int h)
+    {
+        return OPER(static_cast<double>(h));
+    }
+
+    size_t results(int h)
+    {
+        std::lock_guard lock(returned_mutex);
+        const auto i = returned.find(h);
+
+        return i == returned.end() ? 0 : i->second.size();
+    }
+    OPER result(int h)
+    {
+        std::lock_guard lock(returned_mutex);
+
+        return returned[h].front();
+    }
+
+    // Worker deques are stolen from when their owner is busy
+    void test_stealing()
+    {
+        work_pool pool(3, 64);
+        gate g;
+        std::atomic<int> ran{ 0 };
+        std::atomic<bool> stolen{ true };
+        std::thread::id owner;
+
+        pool.submit([&] {
+            owner = std::this_thread::get_id();
+            // Pushed to this worker's own deque, which it cannot pop while busy
+            for (int i = 0; i < 8; ++i) {
+                pool.submit([&] {
+                    if (std::this_thread::get_id() == owner) {
+                        stolen = false;
+                    }
+                    ++ran;
+                });
+            }
+            g.wait();
+        });
+
+        check(eventually([&] { return ran == 8; }), "idle workers steal from a busy worker");
+        check(stolen, "stolen tasks run on other workers");
+        g.release();
+    }
+
+    // submit fails once capacity tasks are queued
+    void test_capacity()
+    {
+        work_pool pool(1, 4);
+        gate g;
+        std::atomic<bool> started{ false };
+        std::atomic<int> ran{ 0 };
+
+        pool.submit([&] {
+            started = true;
+            g.wait();
+        });
+        check(eventually([&] { return started.load(); }), "blocking task starts");
+
+        bool accepted = true;
+        for (int i = 0; i < 4; ++i) {
+            accepted = pool.submit([&] { ++ran; }) && accepted;
+        }
+        check(accepted, "tasks up to capacity are queued");
+        check(!pool.submit([&] { ++ran; }), "task past capacity is rejected");
+        check(pool.pending() == 4, "rejected task is not counted");
+
+        g.release();
+        check(eventually([&] { return ran == 4; }), "queued tasks run");
+        check(pool.submit([&] { ++ran; }) && eventually([&] { return ran == 5; }), "queue accepts tasks after draining");
+    }
+
+    // stop waits for running tasks and discards queued ones
+    void test_stop()
+    {
+        work_pool pool(1, 8);
+        gate g;
+        std::atomic<bool> started{ false };
+        std::atomic<bool> finished{ false };
+        std::atomic<int> ran{ 0 };
+
+        pool.submit([&] {
+            started = true;
+            g.wait();
+            finished = true;
+        });
+        check(eventually([&] { return started.load(); }), "blocking task starts");
+        for (int i = 0; i < 3; ++i) {
+            pool.submit([&] { ++ran; });
+        }
+
+        std::thread opener([&] {
+            std::this_thread::sleep_for(20ms);
+            g.release();
+        });
+        pool.stop();
+        opener.join();
+
+        check(finished, "stop waits for the running task");
+        check(ran == 0, "stop discards queued tasks");
+        check(pool.pending() == 0, "nothing is pending after stop");
+        check(!pool.submit([&] { ++ran; }), "stopped pool rejects tasks");
+    }
+
+    // Identical requests share one computation, colliding keys do not
+    void test_coalescing()
+    {
+        async_stats(true);
+        gate g;
+        std::atomic<int> first{ 0 };
+        std::atomic<int> second{ 0 };
+
+        const uint64_t key = 1;
+        const auto compute = [&](std::atomic<int>& calls, double value) {
+            return [&calls, &g, value] {
+                ++calls;
+                g.wait();
+
+                return OPER(value);
+            };
+        };
+        async_call(key, { 1, 2 }, async_handle(1), compute(first, 10));
+        async_call(key, { 1, 2 }, async_handle(2), compute(first, 10));
+        async_call(key, { 1, 2 }, async_handle(3), compute(first, 10));
+        async_call(key, { 3 }, async_handle(4), compute(second, 20));
+
+        const auto stats = async_stats(true);
+        check(stats.submitted == 2, "duplicates are submitted once and a collision separately");
+        check(stats.coalesced == 2, "duplicates in flight are coalesced");
+
+        g.release();
+        check(eventually([] { return results(1) && results(2) && results(3) && results(4); }), "every handle is answered");
+        check(first == 1, "coalesced requests compute once");
+        check(second == 1, "colliding request computes its own result");
+        for (int h : { 1, 2, 3 }) {
+            check(result(h) == 10, "coalesced handles receive the shared result");
+        }
+        check(result(4) == 20, "colliding handle receives its own result");
+
+        // A finished request is no longer in flight
+        async_call(key, { 1, 2 }, async_handle(5), compute(first, 10));
+        check(eventually([] { return results(5) == 1; }) && first == 2, "finished request is computed again");
+    }
+
+    // A throwing computation returns #NUM!
+    void test_error()
+    {
+        async_call(2, {}, async_handle(6), []() -> OPER { throw std::runtime_error("kernel failed"); });
+        check(eventually([] { return results(6) == 1; }), "throwing request is answered");
+        check(result(6) == ErrNum, "throwing request returns #NUM!");
+    }
+
+    // A full pool runs requests on the calling thread
+    void test_inline()
+    {
+        auto& pool = linalg_pool();
+        gate g;
+        std::atomic<unsigned> started{ 0 };
+        std::atomic<int> ran{ 0 };
+
+        // Occupy every worker, then fill the queue
+        for (unsigned i = 0; i < pool.threads(); ++i) {
+            pool.submit([&] {
+                ++started;
+                g.wait();
+            });
+        }
+        check(eventually([&] { return started == pool.threads(); }), "workers are occupied");
+        size_t queued = 0;
+        while (pool.submit([&] { ++ran; })) {
+            ++queued;
+        }
+
+        async_stats(true);
+        std::thread::id caller;
+        async_call(3, { 7 }, async_handle(7), [&caller] {
+            caller = std::this_thread::get_id();
+
+            return OPER(70.);
+        });
+        check(async_stats(true).inlined == 1, "request to a full pool runs inline");
+        check(results(7) == 1 && result(7) == 70, "inline request is answered before returning");
+        check(caller == std::this_thread::get_id(), "inline request runs on the calling thread");
+
+        g.release();
+        check(eventually([&] { return ran == static_cast<int>(queued); }), "queued tasks run after the pool drains");
+    }
+
+    // MATRIX.INVERSE.ASYNC through Excel12v(xlAsyncReturn, ...)
+    void test_kernel()
+    {
+        const double a[] = { 4, 1, 0, 1, 5, 2, 0, 2, 6 };
+        FPX A(3, 3, a);
+        const _FP12* inverse = xll_matrix_inv(A.get());
+        const std::vector<double> expected(inverse->array, inverse->array + 9);
+
+        for (int h : { 8, 9, 10 }) {
+            OPER x = async_handle(h);
+            xll_matrix_inv_async(A.get(), &x);
+        }
+        check(eventually([] { return results(8) && results(9) && results(10); }), "MATRIX.INVERSE.ASYNC answers every handle");
+        for (int h : { 8, 9, 10 }) {
+            const OPER x = result(h);
+            bool equal = rows(x) == 3 && columns(x) == 3;
+            for (int i = 0; equal && i < 9; ++i) {
+                equal = std::fabs(Num(x[i]) - expected[static_cast<size_t>(i)]) <= 1e-15;
+            }
+            check(equal, "MATRIX.INVERSE.ASYNC returns the inverse");
+        }
+    }
+
+    // xlAutoClose stops the pool and later requests run inline
+    void test_close()
+    {
+        check(Auto<Close>::Call() == 1, "xlAutoClose succeeds");
+        check(!linalg_pool().submit([] { }), "pool is stopped");
+
+        async_stats(true);
+        async_call(4, { 11 }, async_handle(11), [] { return OPER(110.); });
+        check(async_stats(true).inlined == 1, "request after close runs inline");
+        check(results(11) == 1 && result(11) == 110, "request after close is answered");
+    }
+
+} // namespace
+
+int main()
+{
+    test_stealing();
+    test_capacity();
+    test_stop();
+
+    async_return = record;
+    test_coalescing();
+    test_error();
+    test_inline();
+
+    async_return = excel_async_return;
+    test::async_returned = record;
+    test_kernel();
+    test_close();
+
+    // Give stray duplicate returns a chance to arrive
+    std::this_thread::sleep_for(50ms);
+    std::lock_guard lock(returned_mutex);
+    for (const auto& [h, r] : returned) {
+        if (r.size() != 1) {
+            ++failures;
+            std::fprintf(stderr, "failed: handle %d received %zu results\n", h, r.size());
+        }
+    }
+
+    std::printf("%zu handles answered, %d failures\n", returned.size(), failures);
+
+    return failures ? 1 : 0;
+}
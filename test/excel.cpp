@@ -0,0 +1,31 @@
+// ==============================================================================
+// excel.cpp - Stand-in for the Excel entry points
+// ==============================================================================
+// The kernel tests run without Excel. xlFree succeeds, xlAsyncReturn is
+// passed to test::async_returned, and every other call fails with
+// xlretFailed, as Excel does for a function that is not available to the
+// caller.
+// ==============================================================================
+
+#include "excel.h"
+
+int _cdecl Excel12(int xlfn, LPXLOPER12 operRes, int count, ...)
+{
+    (void)operRes;
+    (void)count;
+
+    return xlfn == xlFree ? xlretSuccess : xlretFailed;
+}
+
+int pascal Excel12v(int xlfn, LPXLOPER12 operRes, int count, LPXLOPER12 opers[])
+{
+    if (xlfn == xlAsyncReturn && count == 2 && xll::test::async_returned) {
+        xll::test::async_returned(*opers[0], *opers[1]);
+        operRes->xltype = xltypeBool;
+        operRes->val.xbool = TRUE;
+
+        return xlretSuccess;
+    }
+
+    return xlfn == xlFree ? xlretSuccess : xlretFailed;
+}
@@ -0,0 +1,17 @@
+#pragma once
+// ==============================================================================
+// excel.h - Stand-in for the Excel entry points
+// ==============================================================================
+// Tests observe xlAsyncReturn by setting async_returned. Calls are made on the
+// worker threads that finish asynchronous functions.
+// ==============================================================================
+
+#include <functional>
+#include "xll24/include/xll.h"
+
+namespace xll::test {
+
+    // Receives the handle and result of each Excel12v(xlAsyncReturn, ...)
+    inline std::function<void(const XLOPER12& handle, const XLOPER12& result)> async_returned;
+
+} // namespace xll::test
@@ -0,0 +1,184 @@
+// ==============================================================================
+// linalg_threads.cpp - LINALG kernels called from many threads at once
+// ==============================================================================
+// Every LINALG function is registered thread safe, so Excel may call them from
+// all of its calculation threads together. Each thread here calls the kernels
+// on the same arguments and compares the results with values computed serially
+// beforehand. Results are returned in thread-local buffers and results of
+// large arguments go through the shared cache, so a race on either shows up
+// as a wrong value. One more thread keeps shrinking and restoring the cache
+// budget so that lookups race with eviction.
+// ==============================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "cache.h"
+
+using namespace xll;
+
+// Kernels from linalg.cpp
+extern "C" {
+_FP12* WINAPI xll_matrix_inv(_FP12* pa);
+_FP12* WINAPI xll_matrix_solve(_FP12* pa, _FP12* pb);
+_FP12* WINAPI xll_matrix_mul(_FP12* pa, _FP12* pb);
+_FP12* WINAPI xll_matrix_solve_refine(_FP12* pa, _FP12* pb, double maxiter);
+double WINAPI xll_matrix_det(_FP12* pa);
+}
+
+namespace {
+
+    enum class kind { general, spd, lower };
+
+    // n×n matrix of the given kind with entries drawn from seed. General
+    // matrices are diagonally dominant so every kernel succeeds.
+    FPX test_matrix(int n, kind k, unsigned seed)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> u(-1, 1);
+
+        const auto m = static_cast<size_t>(n);
+        std::vector<double> A(m * m);
+        const auto a = [&A, m](int i, int j) -> double& { return A[static_cast<size_t>(i) * m + static_cast<size_t>(j)]; };
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                a(i, j) = k == kind::lower && j > i ? 0 : u(gen);
+            }
+            a(i, i) += n;
+        }
+        if (k == kind::spd) {
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < i; ++j) {
+                    a(j, i) = a(i, j);
+                }
+            }
+        }
+
+        return FPX(n, n, A.data());
+    }
+
+    std::vector<double> values(const _FP12* fp)
+    {
+        return fp ? std::vector<double>(fp->array, fp->array + xll::size(*fp)) : std::vector<double>{};
+    }
+
+    // Arguments and the results of the kernels computed on one thread
+    struct problem {
+        FPX A, b;
+        std::vector<double> inverse, solution, product, refined;
+        double determinant;
+
+        problem(int n, kind k, unsigned seed)
+            : A(test_matrix(n, k, seed)), b(test_matrix(n, kind::general, seed + 1))
+        {
+            b.resize(n, 1);
+            inverse = values(xll_matrix_inv(A.get()));
+            solution = values(xll_matrix_solve(A.get(), b.get()));
+            product = values(xll_matrix_mul(A.get(), A.get()));
+            refined = values(xll_matrix_solve_refine(A.get(), b.get(), 10));
+            determinant = xll_matrix_det(A.get());
+        }
+    };
+
+    // Tolerance for kernels that may split work differently between runs
+    bool close(const std::vector<double>& x, const _FP12* fp)
+    {
+        if (!fp || x.size() != static_cast<size_t>(xll::size(*fp))) {
+            return false;
+        }
+        double scale = 1;
+        for (double xi : x) {
+            scale = (std::max)(scale, std::fabs(xi));
+        }
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (!(std::fabs(x[i] - fp->array[i]) <= 1e-12 * scale)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::atomic<int> failures{ 0 };
+
+    void check(bool ok, const char* what, int thread, int n)
+    {
+        if (!ok && failures++ < 10) {
+            std::fprintf(stderr, "thread %d: %s of %d×%d differs from the serial result\n", thread, what, n, n);
+        }
+    }
+
+} // namespace
+
+int main()
+{
+    // 2×2 to 6×6 take the fixed-size kernels, 16×16 and up are cached and
+    // 130×130 products are split across the pool
+    std::vector<problem> problems;
+    unsigned seed = 1;
+    for (int n : { 2, 3, 6, 9, 16, 40, 130 }) {
+        for (kind k : { kind::general, kind::spd, kind::lower }) {
+            problems.emplace_back(n, k, seed);
+            seed += 2;
+        }
+    }
+
+    auto& cache = linalg_cache();
+    cache.clear();
+    cache.stats(true);
+    const size_t budget = cache.budget(0);
+    cache.budget(budget);
+
+    const int threads = static_cast<int>((std::max)(8u, std::thread::hardware_concurrency()));
+    constexpr int rounds = 50;
+
+    std::atomic<bool> done{ false };
+    std::thread evictor([&] {
+        while (!done) {
+            cache.budget(4096);
+            std::this_thread::yield();
+            cache.budget(budget);
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int r = 0; r < rounds; ++r) {
+                // Threads start at different problems so they overlap on all of them
+                for (size_t i = 0; i < problems.size(); ++i) {
+                    problem& p = problems[(i + static_cast<size_t>(t)) % problems.size()];
+                    const int n = p.A.rows();
+
+                    // The buffer must not change while other threads compute
+                    _FP12* inverse = xll_matrix_inv(p.A.get());
+                    std::this_thread::yield();
+                    check(close(p.inverse, inverse), "MATRIX.INVERSE", t, n);
+
+                    check(close(p.solution, xll_matrix_solve(p.A.get(), p.b.get())), "MATRIX.SOLVE", t, n);
+                    check(close(p.product, xll_matrix_mul(p.A.get(), p.A.get())), "MATRIX.MUL", t, n);
+                    check(close(p.refined, xll_matrix_solve_refine(p.A.get(), p.b.get(), 10)), "MATRIX.SOLVE.REFINE", t, n);
+                    const double det = xll_matrix_det(p.A.get());
+                    check(det == p.determinant || std::fabs(det - p.determinant) <= 1e-12 * std::fabs(p.determinant),
+                        "MATRIX.DETERMINANT", t, n);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    done = true;
+    evictor.join();
+
+    const auto stats = cache.stats();
+    std::printf("%d threads × %d rounds × %zu problems: %d failures, %llu cache hits, %llu misses\n",
+        threads, rounds, problems.size(), failures.load(), stats.hits, stats.misses);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Windows.h - Same as windows.h on case-sensitive file systems
+#include "windows.h"
@@ -0,0 +1,3 @@
+#pragma once
+// stringapiset.h - Declared in windows.h
+#include "windows.h"
@@ -0,0 +1,3 @@
+#pragma once
+// timezoneapi.h - Declared in windows.h
+#include "windows.h"
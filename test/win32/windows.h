@@ -0,0 +1,182 @@
+#pragma once
+// ==============================================================================
+// windows.h - Win32 declarations used by the xll24 headers
+// ==============================================================================
+// Lets the LINALG kernels be compiled and tested off Windows. Only the types,
+// constants and functions the headers name are declared. Functions that would
+// talk to Windows do nothing and report failure.
+// ==============================================================================
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+
+#define WINAPI
+#define CALLBACK
+#define __stdcall
+#define __cdecl
+#define _cdecl
+#define pascal
+#define __declspec(x)
+
+#define TRUE 1
+#define FALSE 0
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef int INT;
+typedef unsigned int UINT;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef short SHORT;
+typedef unsigned short USHORT;
+typedef int32_t INT32;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef intptr_t LRESULT;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef void VOID;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef BYTE* LPBYTE;
+typedef DWORD* LPDWORD;
+typedef void* LPVOID;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCWSTR;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HINSTANCE;
+typedef void* HMODULE;
+typedef void* HGLOBAL;
+typedef void* HKEY;
+typedef long LSTATUS;
+typedef int (*FARPROC)();
+
+typedef struct { long x, y; } POINT;
+
+#define MAX_PATH 260
+#define CP_UTF8 65001
+#define IntToPtr(i) reinterpret_cast<void*>(static_cast<intptr_t>(i))
+
+// Registry
+#define ERROR_SUCCESS 0
+#define ERROR_FILE_NOT_FOUND 2
+#define HKEY_CURRENT_USER reinterpret_cast<HKEY>(1)
+#define KEY_READ 0
+#define KEY_WRITE 0
+#define KEY_ALL_ACCESS 0
+#define REG_DWORD 4
+#define REG_OPTION_NON_VOLATILE 0
+
+inline LSTATUS RegOpenKeyExA(HKEY, LPCSTR, DWORD, DWORD, HKEY*) { return ERROR_FILE_NOT_FOUND; }
+inline LSTATUS RegCreateKeyExA(HKEY, LPCSTR, DWORD, LPSTR, DWORD, DWORD, void*, HKEY*, LPDWORD) { return ERROR_FILE_NOT_FOUND; }
+inline LSTATUS RegQueryValueExA(HKEY, LPCSTR, LPDWORD, LPDWORD, LPBYTE, LPDWORD) { return ERROR_FILE_NOT_FOUND; }
+inline LSTATUS RegSetValueExA(HKEY, LPCSTR, DWORD, DWORD, const BYTE*, DWORD) { return ERROR_FILE_NOT_FOUND; }
+inline LSTATUS RegCloseKey(HKEY) { return ERROR_SUCCESS; }
+
+// Message boxes
+#define MB_OK 0
+#define MB_OKCANCEL 1
+#define MB_ICONERROR 0x10
+#define MB_ICONWARNING 0x30
+#define MB_ICONINFORMATION 0x40
+#define IDOK 1
+#define IDCANCEL 2
+
+inline int MessageBoxA(HWND, LPCSTR, LPCSTR, UINT) { return IDCANCEL; }
+inline int MessageBoxW(HWND, LPCWSTR, LPCWSTR, UINT) { return IDCANCEL; }
+
+inline void OutputDebugStringA(LPCSTR) { }
+inline DWORD GetLastError() { return 0; }
+
+// UTF-8 conversion, one wchar_t per code point. A length of -1 includes the
+// null terminator and an output size of 0 returns the size needed.
+inline int MultiByteToWideChar(UINT, DWORD, LPCSTR s, int n, LPWSTR ws, int wn)
+{
+    if (n == -1) {
+        n = static_cast<int>(std::strlen(s)) + 1;
+    }
+
+    int k = 0;
+    for (int i = 0; i < n; ++k) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        const int len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        unsigned long cp = len == 1 ? c : c & (0x7Fu >> len);
+        for (int j = 1; j < len && i + j < n; ++j) {
+            cp = (cp << 6) | (static_cast<unsigned char>(s[i + j]) & 0x3Fu);
+        }
+        i += len;
+        if (wn) {
+            if (k >= wn) {
+                return 0;
+            }
+            ws[k] = static_cast<wchar_t>(cp);
+        }
+    }
+
+    return k;
+}
+inline int WideCharToMultiByte(UINT, DWORD, LPCWSTR ws, int wn, LPSTR s, int n, LPCSTR, BOOL*)
+{
+    if (wn == -1) {
+        wn = static_cast<int>(std::wcslen(ws)) + 1;
+    }
+
+    int k = 0;
+    for (int i = 0; i < wn; ++i) {
+        const unsigned long cp = static_cast<unsigned long>(ws[i]);
+        const int len = cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+        if (n) {
+            if (k + len > n) {
+                return 0;
+            }
+            s[k] = static_cast<char>(len == 1 ? cp : (0xF00u >> len) | (cp >> (6 * (len - 1))));
+            for (int j = 1; j < len; ++j) {
+                s[k + j] = static_cast<char>(0x80u | ((cp >> (6 * (len - 1 - j))) & 0x3Fu));
+            }
+        }
+        k += len;
+    }
+
+    return k;
+}
+
+// Time zones
+typedef struct { WORD wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds; } SYSTEMTIME;
+typedef struct { DWORD dwLowDateTime, dwHighDateTime; } FILETIME;
+typedef struct {
+    LONG Bias;
+    WCHAR StandardName[32];
+    SYSTEMTIME StandardDate;
+    LONG StandardBias;
+    WCHAR DaylightName[32];
+    SYSTEMTIME DaylightDate;
+    LONG DaylightBias;
+} TIME_ZONE_INFORMATION;
+typedef struct {
+    LONG Bias;
+    WCHAR StandardName[32];
+    SYSTEMTIME StandardDate;
+    LONG StandardBias;
+    WCHAR DaylightName[32];
+    SYSTEMTIME DaylightDate;
+    LONG DaylightBias;
+    WCHAR TimeZoneKeyName[128];
+    BOOL DynamicDaylightTimeDisabled;
+} DYNAMIC_TIME_ZONE_INFORMATION;
+#define TIME_ZONE_ID_INVALID static_cast<DWORD>(0xFFFFFFFF)
+
+inline DWORD GetTimeZoneInformation(TIME_ZONE_INFORMATION*) { return TIME_ZONE_ID_INVALID; }
+inline DWORD GetDynamicTimeZoneInformation(DYNAMIC_TIME_ZONE_INFORMATION*) { return TIME_ZONE_ID_INVALID; }
+inline BOOL SystemTimeToFileTime(const SYSTEMTIME*, FILETIME*) { return FALSE; }
+inline BOOL FileTimeToSystemTime(const FILETIME*, SYSTEMTIME*) { return FALSE; }
+inline BOOL SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION*, const SYSTEMTIME*, SYSTEMTIME*) { return FALSE; }
+inline BOOL TzSpecificLocalTimeToSystemTime(const TIME_ZONE_INFORMATION*, const SYSTEMTIME*, SYSTEMTIME*) { return FALSE; }